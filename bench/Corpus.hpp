@@ -0,0 +1,293 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * A generator of synthetic DDI files, to benchmark mgt without a real build tree. The files are P1689 dependency
+ * files, as written by the compilers.
+ */
+namespace corpus
+{
+    //! How the number of imports per module is distributed
+    enum class FanOut
+    {
+        //! Every module imports the same number of modules
+        fixed,
+        //! Uniformly distributed between 0 and twice the mean
+        uniform,
+        //! Most modules import a few, some import a lot. Pareto distributed, like real code bases.
+        powerLaw
+    };
+
+    //! The shape of a corpus
+    struct Options
+    {
+        //! The number of modules, without partitions
+        std::size_t numModules = 1000;
+
+        //! The number of partitions of each module. Each one is a file of its own, imported by its module.
+        std::size_t partitionsPerModule = 0;
+
+        //! The mean number of modules each module imports
+        double fanOut = 4;
+
+        //! How the number of imports is distributed around the mean
+        FanOut distribution = FanOut::powerLaw;
+
+        //! The sizes of the circular dependencies to plant. Each one is an SCC of exactly that many modules.
+        std::vector< std::size_t > sccSizes;
+
+        //! The number of modules that are imported, but not provided by any file
+        std::size_t numMissing = 0;
+
+        //! The number of modules that are provided by a second file
+        std::size_t numDuplicates = 0;
+
+        //! The number of translation units that import modules without providing one
+        std::size_t numConsumers = 0;
+
+        //! The seed of the random numbers. The same options and seed generate the same corpus.
+        std::uint64_t seed = 1;
+    };
+
+    //! What was generated
+    struct Stats
+    {
+        //! The number of DDI files
+        std::size_t numFiles = 0;
+        //! The number of distinct modules and partitions, including the missing ones. A module provided twice counts
+        //! once. This is the number of modules mgt finds.
+        std::size_t numModules = 0;
+        //! The number of imports, without those of the duplicate rules. They import the same as the original.
+        std::size_t numImports = 0;
+        //! The size of all files
+        std::size_t numBytes = 0;
+    };
+
+    /**
+     * Parse a fan-out distribution: "fixed", "uniform" or "power-law".
+     *
+     * @throw std::runtime_error If the name is unknown.
+     */
+    [[nodiscard]] inline FanOut parseFanOut(std::string_view name)
+    {
+        if (name == "fixed")
+        {
+            return FanOut::fixed;
+        }
+        if (name == "uniform")
+        {
+            return FanOut::uniform;
+        }
+        if (name == "power-law")
+        {
+            return FanOut::powerLaw;
+        }
+        throw std::runtime_error(std::format("Unknown fan-out distribution: {}", name));
+    }
+
+    /**
+     * Generate a corpus. The modules are numbered. Each module only imports modules with a higher number, so the graph
+     * is acyclic, except for the planted circular dependencies. The modules are named like lib3.m3042, so there is a
+     * hierarchy for the DOT export to collapse. Files are spread over sub-directories of 1000 files each.
+     *
+     * @throw std::runtime_error If the options are invalid or a file cannot be written.
+     *
+     * @param directory The directory to write to. Created if needed.
+     * @param options The shape of the corpus
+     *
+     * @return What was generated
+     */
+    [[nodiscard]] inline Stats generate(const std::filesystem::path& directory, const Options& options)
+    {
+        constexpr std::size_t filesPerDirectory = 1000;
+        constexpr std::size_t modulesPerLib = 100;
+
+        if (options.numModules == 0)
+        {
+            throw std::runtime_error("A corpus needs at least 1 module.");
+        }
+
+        std::size_t numPlanted = 0;
+        for (auto size : options.sccSizes)
+        {
+            if (size < 2)
+            {
+                throw std::runtime_error("A circular dependency needs at least 2 modules.");
+            }
+            numPlanted += size;
+        }
+        if ((numPlanted > options.numModules) || (options.numDuplicates > options.numModules))
+        {
+            throw std::runtime_error("Not enough modules for the circular dependencies or duplicate providers.");
+        }
+
+        std::mt19937_64 random(options.seed);
+        auto uniform = [&](std::size_t first, std::size_t last)
+        { return std::uniform_int_distribution< std::size_t >(first, last)(random); };
+
+        // The number of imports of a module
+        auto fanOut = [&]() -> std::size_t
+        {
+            switch (options.distribution)
+            {
+                case FanOut::fixed:
+                    return static_cast< std::size_t >(std::lround(options.fanOut));
+                case FanOut::uniform:
+                    return uniform(0, static_cast< std::size_t >(std::lround(2 * options.fanOut)));
+                case FanOut::powerLaw:
+                    // Pareto with alpha 2 has a mean of twice its minimum. Rounded, truncating would lower the mean.
+                    return static_cast< std::size_t >(std::lround(
+                        options.fanOut / 2 / std::sqrt(1.0 - std::uniform_real_distribution<>(0, 1)(random))));
+            }
+            return 0;
+        };
+
+        auto moduleName = [&](std::size_t module) { return std::format("lib{}.m{}", module / modulesPerLib, module); };
+
+        // The imports of each module: a few distinct modules with a higher number.
+        std::vector< std::vector< std::string > > imports(options.numModules);
+        std::vector< std::size_t > targets;
+        for (std::size_t module = 0; module < options.numModules; ++module)
+        {
+            auto numCandidates = options.numModules - module - 1;
+            auto count = std::min(fanOut(), numCandidates);
+            targets.clear();
+            while (targets.size() < count)
+            {
+                auto target = uniform(module + 1, options.numModules - 1);
+                if (std::ranges::find(targets, target) == targets.end())
+                {
+                    targets.push_back(target);
+                }
+            }
+            std::ranges::sort(targets);
+            for (auto target : targets)
+            {
+                imports[module].push_back(moduleName(target));
+            }
+        }
+
+        // Circular dependencies: a chain through consecutive modules, closed by an import of the first one. Only the
+        // modules of the chain are part of the SCC, as all other imports lead to higher numbers.
+        std::size_t first = 0;
+        for (auto size : options.sccSizes)
+        {
+            for (auto module = first; module + 1 < first + size; ++module)
+            {
+                if (std::ranges::find(imports[module], moduleName(module + 1)) == imports[module].end())
+                {
+                    imports[module].push_back(moduleName(module + 1));
+                }
+            }
+            imports[first + size - 1].push_back(moduleName(first));
+            first += size;
+        }
+
+        for (std::size_t missing = 0; missing < options.numMissing; ++missing)
+        {
+            imports[uniform(0, options.numModules - 1)].push_back(std::format("missing.m{}", missing));
+        }
+
+        // Write the files
+        Stats stats;
+        std::string json;
+        auto write = [&](std::string_view output, std::string_view provides, std::string_view source,
+                         const std::vector< std::string >& requires_)
+        {
+            json.clear();
+            auto out = std::back_inserter(json);
+            std::format_to(out, "{{\"version\": 1, \"revision\": 0, \"rules\": [{{\"primary-output\": \"{}\"", output);
+            if (!provides.empty())
+            {
+                std::format_to(out,
+                               ", \"provides\": [{{\"is-interface\": true, \"logical-name\": \"{}\", "
+                               "\"source-path\": \"{}\"}}]",
+                               provides, source);
+            }
+            json += ", \"requires\": [";
+            for (std::size_t i = 0; i < requires_.size(); ++i)
+            {
+                std::format_to(out, "{}{{\"logical-name\": \"{}\"}}", (i == 0) ? "" : ", ", requires_[i]);
+            }
+            json += "]}]}\n";
+
+            auto path = directory / std::format("d{}", stats.numFiles / filesPerDirectory);
+            if (stats.numFiles % filesPerDirectory == 0)
+            {
+                std::filesystem::create_directories(path);
+            }
+            path /= std::format("f{}.ddi", stats.numFiles);
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(json.data(), static_cast< std::streamsize >(json.size()));
+            if (!file)
+            {
+                throw std::runtime_error(std::format("Cannot write {}", path.string()));
+            }
+            stats.numFiles++;
+            stats.numBytes += json.size();
+        };
+
+        const std::vector< std::string > none;
+        std::vector< std::string > partitions;
+        for (std::size_t module = 0; module < options.numModules; ++module)
+        {
+            auto name = moduleName(module);
+            partitions.clear();
+            for (std::size_t partition = 0; partition < options.partitionsPerModule; ++partition)
+            {
+                partitions.push_back(std::format("{}:p{}", name, partition));
+                write(std::format("{}.p{}.o", name, partition), partitions.back(),
+                      std::format("/src/{}/p{}.cppm", name, partition), none);
+            }
+
+            auto& requires_ = imports[module];
+            requires_.insert(requires_.begin(), partitions.begin(), partitions.end());
+            write(std::format("{}.o", name), name, std::format("/src/{}/{}.cppm", name, name), requires_);
+            stats.numModules += partitions.size() + 1;
+            stats.numImports += requires_.size();
+        }
+        stats.numModules += options.numMissing;
+
+        // Duplicates: the same module, provided by a copy of its source somewhere else.
+        for (std::size_t duplicate = 0; duplicate < options.numDuplicates; ++duplicate)
+        {
+            auto module = duplicate * options.numModules / options.numDuplicates;
+            auto name = moduleName(module);
+            write(std::format("copy/{}.o", name), name, std::format("/copy/{}.cppm", name), imports[module]);
+        }
+
+        std::vector< std::string > consumerImports;
+        for (std::size_t consumer = 0; consumer < options.numConsumers; ++consumer)
+        {
+            consumerImports.clear();
+            auto count = std::min(std::max< std::size_t >(1, fanOut()), options.numModules);
+            while (consumerImports.size() < count)
+            {
+                auto name = moduleName(uniform(0, options.numModules - 1));
+                if (std::ranges::find(consumerImports, name) == consumerImports.end())
+                {
+                    consumerImports.push_back(std::move(name));
+                }
+            }
+            std::ranges::sort(consumerImports);
+            write(std::format("tu{}.cpp.o", consumer), {}, {}, consumerImports);
+            stats.numImports += consumerImports.size();
+        }
+
+        return stats;
+    }
+} // namespace corpus
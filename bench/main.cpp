@@ -0,0 +1,833 @@
+#ifndef NDEBUG
+    #define JSON_DIAGNOSTICS 1
+#endif
+#include <nlohmann/json.hpp>
+
+#include "Corpus.hpp"
+
+#include "mgt/CSRGraph.hpp"
+#include "mgt/Cycles.hpp"
+#include "mgt/DDI.hpp"
+#include "mgt/Discovery.hpp"
+#include "mgt/Interner.hpp"
+#include "mgt/MappedFile.hpp"
+#include "mgt/ModuleGraph.hpp"
+#include "mgt/Parallel.hpp"
+#include "mgt/Profile.hpp"
+#include "mgt/SCC.hpp"
+
+#include <graaflib/algorithm/shortest_path/bfs_shortest_path.h>
+#include <graaflib/algorithm/strongly_connected_components/tarjan.h>
+#include <graaflib/graph.h>
+#include <graaflib/types.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <new>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    //! The number of bytes currently allocated with operator new. Used to measure memory usage.
+    std::atomic< std::size_t > liveBytes = 0;
+
+    //! Space in front of each allocation to remember its size. Keeps the alignment of operator new.
+    constexpr std::size_t allocationHeader = alignof(std::max_align_t);
+} // namespace
+
+// Count all allocations. Only the plain versions are replaced. The array versions forward to them.
+void* operator new(std::size_t size)
+{
+    auto* block = static_cast< std::byte* >(std::malloc(size + allocationHeader)); // NOLINT: manual memory management.
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast< std::size_t* >(block) = size; // NOLINT: that is what the header is for.
+    liveBytes += size;
+    return block + allocationHeader; // NOLINT: pointer arithmetic.
+}
+
+// GCC cannot see that the block was allocated with malloc in the replaced operator new.
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* pointer) noexcept
+{
+    if (pointer == nullptr)
+    {
+        return;
+    }
+    auto* block = static_cast< std::byte* >(pointer) - allocationHeader; // NOLINT: pointer arithmetic.
+    liveBytes -= *reinterpret_cast< std::size_t* >(block);               // NOLINT: see operator new.
+    std::free(block);                                                    // NOLINT: manual memory management.
+}
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic pop
+#endif
+
+void operator delete(void* pointer, [[maybe_unused]] std::size_t size) noexcept
+{
+    operator delete(pointer);
+}
+
+namespace
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Reference implementation
+    //
+    // The nlohmann DOM based DDI parsing that mgt used before the streaming reader. Kept to compare against.
+
+    namespace reference
+    {
+        using mgt::Symbols;
+        using mgt::ddi::DDI;
+
+        void fromJSON(const nlohmann::json& j, Symbols& symbols, DDI::Provide& p)
+        {
+            p.logicalName = symbols.modules.intern(j.at("logical-name").get_ref< const std::string& >());
+            auto sourcePath = (j.count("source-path") != 0)
+                                  ? std::string_view(j.at("source-path").get_ref< const std::string& >())
+                                  : std::string_view("<undefined>");
+            p.sourcePath = symbols.paths.intern(sourcePath);
+        }
+
+        void fromJSON(const nlohmann::json& j, Symbols& symbols, DDI::Require& p)
+        {
+            p.logicalName = symbols.modules.intern(j.at("logical-name").get_ref< const std::string& >());
+        }
+
+        void fromJSON(const nlohmann::json& j, Symbols& symbols, DDI::Rule& p)
+        {
+            if (j.count("provides") != 0)
+            {
+                for (const auto& provide : j.at("provides"))
+                {
+                    fromJSON(provide, symbols, p.provides.emplace_back());
+                }
+            }
+
+            if (j.count("requires") != 0)
+            {
+                for (const auto& require : j.at("requires"))
+                {
+                    fromJSON(require, symbols, p.requires_.emplace_back());
+                }
+            }
+
+            // Like the real reader, keep consumers and drop rules that neither provide nor require anything.
+            if (p.provides.empty() && p.requires_.empty())
+            {
+                return;
+            }
+
+            p.primaryOutput = symbols.paths.intern(j.at("primary-output").get_ref< const std::string& >());
+        }
+
+        DDI parse(std::string_view json, Symbols& symbols)
+        {
+            auto j = nlohmann::json::parse(json);
+
+            DDI ddi;
+            for (const auto& rule : j.at("rules"))
+            {
+                fromJSON(rule, symbols, ddi.rules.emplace_back());
+            }
+            j.at("version").get_to(ddi.version);
+            j.at("revision").get_to(ddi.revision);
+
+            std::erase_if(ddi.rules, [](const auto& rule) { return rule.provides.empty() && rule.requires_.empty(); });
+            return ddi;
+        }
+
+        //! The module graph, as far as the analysis is concerned.
+        using Graph = graaf::directed_graph< mgt::ModuleId, int >;
+
+        /**
+         * Build the module graph the way mgt did before the CSR graph: one graaf vertex per module.
+         *
+         * @param ddis The DDI
+         * @param numModules The number of interned modules. Module IDs are used as vertex IDs.
+         */
+        Graph buildGraph(const std::vector< DDI >& ddis, std::size_t numModules)
+        {
+            Graph graph;
+            for (mgt::ModuleId id = 0; id < numModules; ++id)
+            {
+                graph.add_vertex(id);
+            }
+            for (const auto& rule : ddis | std::views::transform(&DDI::rules) | std::views::join)
+            {
+                for (const auto& provide : rule.provides)
+                {
+                    for (const auto& require : rule.requires_)
+                    {
+                        graph.add_edge(provide.logicalName, require.logicalName, 0);
+                    }
+                }
+            }
+            return graph;
+        }
+
+        /**
+         * The shortest cycle search that mgt used before the cycle engine: a BFS from each in-SCC neighbour of each
+         * SCC node.
+         */
+        std::vector< std::list< graaf::vertex_id_t > > shortestCycles(const Graph& graph,
+                                                                      const graaf::algorithm::sccs_t& sccs)
+        {
+            std::vector< std::list< graaf::vertex_id_t > > cycles;
+            for (const auto& scc : sccs)
+            {
+                std::list< graaf::vertex_id_t > shortest{};
+                for (const auto& id : scc)
+                {
+                    auto inSCC = [&](const auto& neighbourId) { return std::ranges::contains(scc, neighbourId); };
+                    for (const auto& neighbourId : graph.get_neighbors(id) | std::views::filter(inSCC))
+                    {
+                        auto shortestPath =
+                            graaf::algorithm::bfs_shortest_path(graph, neighbourId, id).value().vertices;
+                        shortestPath.push_back(neighbourId);
+
+                        if (shortest.empty() || (shortest.size() > shortestPath.size()))
+                        {
+                            shortest = shortestPath;
+                        }
+                    }
+                }
+                cycles.emplace_back(std::move(shortest));
+            }
+            return cycles;
+        }
+    } // namespace reference
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Tools
+    //
+
+    /**
+     * Run the given function several times and return the fastest run.
+     *
+     * @param rounds The number of runs
+     * @param func The function to measure
+     *
+     * @return The duration of the fastest run in seconds
+     */
+    template < typename Func >
+    double measure(unsigned rounds, Func&& func)
+    {
+        auto best = std::numeric_limits< double >::max();
+        for (unsigned round = 0; round < rounds; ++round)
+        {
+            auto start = std::chrono::steady_clock::now();
+            func();
+            best = std::min(best, std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    //! Number of provides + requires in a set of DDI. Used to check that different parsers agree.
+    std::size_t countClauses(const std::vector< mgt::ddi::DDI >& ddis)
+    {
+        std::size_t result = 0;
+        for (const auto& rule : ddis | std::views::transform(&mgt::ddi::DDI::rules) | std::views::join)
+        {
+            result += rule.provides.size() + rule.requires_.size();
+        }
+        return result;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Benchmarks
+    //
+
+    /**
+     * Compare the nlohmann DOM parser with the streaming DDI reader.
+     *
+     * @param root Where to find the DDI files
+     * @param rounds Number of runs. The fastest is reported.
+     */
+    void benchParse(const std::filesystem::path& root, unsigned rounds)
+    {
+        auto paths = std::filesystem::recursive_directory_iterator(root) |
+                     std::views::filter([](auto&& x) { return x.path().extension() == ".ddi"; }) |
+                     std::views::transform([](auto&& x) { return x.path(); }) | std::ranges::to< std::vector >();
+
+        // Pre-load the contents to only measure parsing.
+        std::vector< std::string > contents;
+        std::size_t numBytes = 0;
+        for (const auto& path : paths)
+        {
+            std::ifstream file(path, std::ios::binary);
+            contents.emplace_back(std::istreambuf_iterator< char >(file), std::istreambuf_iterator< char >());
+            numBytes += contents.back().size();
+        }
+
+        auto report = [&](std::string_view name, double seconds, std::size_t numClauses)
+        {
+            std::cout << std::format("  {:<28} {:>10.3f} ms {:>12.0f} files/s {:>10.1f} MiB/s   ({} clauses)\n", name,
+                                     seconds * 1000.0, static_cast< double >(paths.size()) / seconds,
+                                     static_cast< double >(numBytes) / (1024.0 * 1024.0) / seconds, numClauses);
+        };
+
+        std::cout << std::format("Parsing {} DDI files ({:.1f} MiB), best of {} rounds:\n", paths.size(),
+                                 static_cast< double >(numBytes) / (1024.0 * 1024.0), rounds);
+
+        std::vector< mgt::ddi::DDI > result;
+        auto run = [&](auto&& parseOne)
+        {
+            return measure(rounds,
+                           [&]
+                           {
+                               mgt::Symbols symbols;
+                               result.clear();
+                               for (std::size_t i = 0; i < paths.size(); ++i)
+                               {
+                                   result.push_back(parseOne(paths[i], contents[i], symbols));
+                               }
+                           });
+        };
+
+        auto dom = run([](const auto&, const auto& content, auto& symbols)
+                       { return reference::parse(content, symbols); });
+        report("nlohmann::json DOM", dom, countClauses(result));
+
+        auto streaming = run(
+            [](const auto&, const auto& content, auto& symbols)
+            {
+                mgt::ddi::DDI ddi;
+                mgt::ddi::Reader(content, symbols).read(ddi);
+                return ddi;
+            });
+        report("mgt::ddi::Reader", streaming, countClauses(result));
+
+        // Including IO, as used by mgt.
+        auto mapped = run(
+            [](const auto& path, const auto&, auto& symbols)
+            {
+                const mgt::MappedFile file(path);
+                mgt::ddi::DDI ddi;
+                mgt::ddi::Reader(file.view(), symbols).read(ddi);
+                return ddi;
+            });
+        report("mgt::ddi::Reader + file IO", mapped, countClauses(result));
+
+        std::cout << std::format("  Speedup of the reader over the DOM: {:.1f}x\n", dom / streaming);
+    }
+
+    /**
+     * Compare the per-neighbour BFS shortest cycle search with the cycle engine.
+     *
+     * @param root Where to find the DDI files
+     * @param rounds Number of runs. The fastest is reported.
+     */
+    void benchCycles(const std::filesystem::path& root, unsigned rounds)
+    {
+        mgt::Symbols symbols;
+        auto loaded = mgt::ddi::load(root, symbols, mgt::defaultJobs());
+
+        auto graph = reference::buildGraph(loaded.ddis, symbols.modules.size());
+
+        auto sccs = graaf::algorithm::tarjans_strongly_connected_components(graph) |
+                    std::views::filter([](const auto& scc) { return scc.size() > 1; }) |
+                    std::ranges::to< std::vector >();
+        std::size_t largest = 0;
+        for (const auto& scc : sccs)
+        {
+            largest = std::max(largest, scc.size());
+        }
+
+        std::cout << std::format("Shortest cycles of {} SCCs (largest: {} modules), best of {} rounds:\n", sccs.size(),
+                                 largest, rounds);
+
+        auto report = [&](std::string_view name, double seconds, std::size_t totalLength)
+        {
+            std::cout << std::format("  {:<28} {:>10.3f} ms   (total cycle length: {})\n", name, seconds * 1000.0,
+                                     totalLength);
+        };
+
+        std::size_t totalLength = 0;
+        auto bfs = measure(rounds,
+                           [&]
+                           {
+                               totalLength = 0;
+                               for (const auto& cycle : reference::shortestCycles(graph, sccs))
+                               {
+                                   totalLength += cycle.size();
+                               }
+                           });
+        report("per-neighbour BFS", bfs, totalLength);
+
+        auto neighbours = [&](graaf::vertex_id_t id) { return graph.get_neighbors(id); };
+        auto engine = [&](unsigned jobs)
+        {
+            return measure(rounds,
+                           [&]
+                           {
+                               totalLength = 0;
+                               auto cycles = mgt::findShortestCycles(graph.vertex_count(), sccs, neighbours,
+                                                                     {.maxCycles = 1, .jobs = jobs});
+                               for (const auto& cycle : cycles | std::views::join)
+                               {
+                                   totalLength += cycle.size();
+                               }
+                           });
+        };
+
+        auto serial = engine(1);
+        report("mgt::findShortestCycles", serial, totalLength);
+        auto parallel = engine(mgt::defaultJobs());
+        report(std::format("mgt::findShortestCycles -j{}", mgt::defaultJobs()), parallel, totalLength);
+
+        std::cout << std::format("  Speedup of the engine over the BFS loop: {:.1f}x\n",
+                                 bfs / std::min(serial, parallel));
+    }
+
+    /**
+     * Compare the graaf based module graph with the CSR graph: memory, build time, SCCs and a traversal of all edges.
+     *
+     * @param root Where to find the DDI files
+     * @param rounds Number of runs. The fastest is reported.
+     */
+    void benchGraph(const std::filesystem::path& root, unsigned rounds)
+    {
+        mgt::Symbols symbols;
+        auto loaded = mgt::ddi::load(root, symbols, mgt::defaultJobs());
+        auto numModules = symbols.modules.size();
+
+        std::vector< mgt::GraphEdge > edges;
+        for (const auto& rule : loaded.ddis | std::views::transform(&mgt::ddi::DDI::rules) | std::views::join)
+        {
+            for (const auto& provide : rule.provides)
+            {
+                for (const auto& require : rule.requires_)
+                {
+                    edges.emplace_back(provide.logicalName, require.logicalName);
+                }
+            }
+        }
+
+        std::cout << std::format("Graph of {} modules and {} edges (with duplicates), best of {} rounds:\n", numModules,
+                                 edges.size(), rounds);
+        std::cout << std::format("  {:<10} {:>12} {:>12} {:>12} {:>12}   {}\n", "", "memory", "build", "SCC",
+                                 "traversal", "(SCCs, edges)");
+
+        auto report = [&](std::string_view name, std::size_t bytes, double build, double scc, double traversal,
+                          std::size_t numSCCs, std::size_t numEdges)
+        {
+            std::cout << std::format("  {:<10} {:>8.2f} MiB {:>9.3f} ms {:>9.3f} ms {:>9.3f} ms   ({}, {})\n", name,
+                                     static_cast< double >(bytes) / (1024.0 * 1024.0), build * 1000.0, scc * 1000.0,
+                                     traversal * 1000.0, numSCCs, numEdges);
+        };
+
+        // graaf
+        {
+            auto before = liveBytes.load();
+            auto graph = reference::buildGraph(loaded.ddis, numModules);
+            auto bytes = liveBytes.load() - before;
+
+            auto build = measure(rounds, [&] { static_cast< void >(reference::buildGraph(loaded.ddis, numModules)); });
+
+            std::size_t numSCCs = 0;
+            auto scc = measure(rounds,
+                               [&]
+                               {
+                                   numSCCs = static_cast< std::size_t >(std::ranges::count_if(
+                                       graaf::algorithm::tarjans_strongly_connected_components(graph),
+                                       [](const auto& component) { return component.size() > 1; }));
+                               });
+
+            std::size_t numEdges = 0;
+            auto traversal = measure(rounds,
+                                     [&]
+                                     {
+                                         numEdges = 0;
+                                         for (const auto& [id, _] : graph.get_vertices())
+                                         {
+                                             numEdges += graph.get_neighbors(id).size();
+                                         }
+                                     });
+
+            report("graaf", bytes, build, scc, traversal, numSCCs, numEdges);
+        }
+
+        // CSR
+        {
+            auto before = liveBytes.load();
+            const mgt::CSRGraph graph(numModules, edges);
+            auto bytes = liveBytes.load() - before;
+
+            auto build = measure(rounds, [&] { static_cast< void >(mgt::CSRGraph(numModules, edges)); });
+
+            std::size_t numSCCs = 0;
+            auto sccWith = [&](mgt::SCCAlgorithm algorithm, unsigned jobs)
+            {
+                return measure(rounds,
+                               [&]
+                               {
+                                   numSCCs = mgt::stronglyConnectedComponents(
+                                                 graph, {.minSize = 2, .jobs = jobs, .algorithm = algorithm})
+                                                 .size();
+                               });
+            };
+            auto scc = sccWith(mgt::SCCAlgorithm::tarjan, 1);
+
+            std::size_t numEdges = 0;
+            auto traversal = measure(rounds,
+                                     [&]
+                                     {
+                                         numEdges = 0;
+                                         for (mgt::VertexId id = 0; id < graph.numVertices(); ++id)
+                                         {
+                                             numEdges += graph.successors(id).size();
+                                         }
+                                     });
+
+            report("CSR", bytes, build, scc, traversal, numSCCs, numEdges);
+
+            auto jobs = mgt::defaultJobs();
+            auto forwardBackward = sccWith(mgt::SCCAlgorithm::forwardBackward, jobs);
+            std::cout << std::format("  SCCs with Tarjan: {:.3f} ms, with forward-backward -j{}: {:.3f} ms ({})\n",
+                                     scc * 1000.0, jobs, forwardBackward * 1000.0, numSCCs);
+        }
+    }
+
+    /**
+     * Compare the plain recursive directory walk with the DDI discovery, which prefers the build system's records.
+     *
+     * @param root Where to find the DDI files
+     * @param rounds Number of runs. The fastest is reported.
+     */
+    void benchDiscover(const std::filesystem::path& root, unsigned rounds)
+    {
+        // Like the DDI loading did before: a recursive walk that collects all DDI files.
+        auto isDDI = [](auto&& x) { return x.path().extension() == ".ddi"; };
+        std::size_t numFiles = 0;
+        auto walk = measure(rounds,
+                            [&]
+                            {
+                                numFiles = (std::filesystem::recursive_directory_iterator(root) |
+                                            std::views::filter(isDDI) |
+                                            std::views::transform([](auto&& x) { return x.path(); }) |
+                                            std::ranges::to< std::vector >())
+                                               .size();
+                            });
+        std::cout << std::format("Discovery of {} DDI files, best of {} rounds:\n", numFiles, rounds);
+        std::cout << std::format("  {:<44} {:>10.3f} ms\n", "recursive_directory_iterator", walk * 1000.0);
+
+        for (auto jobs : {1U, mgt::defaultJobs()})
+        {
+            mgt::ddi::Discovery discovery;
+            auto time = measure(rounds, [&] { discovery = mgt::ddi::discover(root, jobs); });
+            std::cout << std::format("  {:<44} {:>10.3f} ms   ({} files)\n",
+                                     std::format("mgt::ddi::discover -j{} ({})", jobs,
+                                                 mgt::ddi::toString(discovery.source)),
+                                     time * 1000.0, discovery.files.size());
+        }
+    }
+
+    /**
+     * Compare memory and build time of the module graph with and without consumers, the translation units that import
+     * modules without providing one.
+     *
+     * @param root Where to find the DDI files
+     * @param rounds Number of runs. The fastest is reported.
+     */
+    void benchConsumers(const std::filesystem::path& root, unsigned rounds)
+    {
+        std::cout << std::format("Module graph of {}, best of {} rounds:\n", root.string(), rounds);
+        std::cout << std::format("  {:<16} {:>12} {:>12} {:>10} {:>10}\n", "", "memory", "build", "modules",
+                                 "consumers");
+
+        std::size_t withoutBytes = 0;
+        for (auto consumers : {false, true})
+        {
+            const mgt::LoadOptions options{.jobs = mgt::defaultJobs(),
+                                           .cacheFile = {},
+                                           .cyclesPerSCC = 1,
+                                           .reachability = false,
+                                           .consumers = consumers};
+
+            // Includes everything the graph keeps: the DDI, the symbol tables and the graph itself.
+            auto before = liveBytes.load();
+            auto graph = mgt::ModuleGraph::make(root, options);
+            auto bytes = liveBytes.load() - before;
+
+            auto build = measure(rounds, [&] { static_cast< void >(mgt::ModuleGraph::make(root, options)); });
+            std::cout << std::format("  {:<16} {:>8.2f} MiB {:>9.3f} ms {:>10} {:>10}\n",
+                                     consumers ? "with consumers" : "modules only",
+                                     static_cast< double >(bytes) / (1024.0 * 1024.0), build * 1000.0,
+                                     graph.numModules(), graph.numConsumers());
+
+            if (!consumers)
+            {
+                withoutBytes = bytes;
+            }
+            else if (graph.numConsumers() > 0)
+            {
+                std::cout << std::format("  {:.1f} bytes per consumer for the graph\n",
+                                         static_cast< double >(bytes - withoutBytes) /
+                                             static_cast< double >(graph.numConsumers()));
+            }
+        }
+    }
+
+    /**
+     * Write a synthetic corpus of DDI files. See @ref corpus::generate.
+     *
+     * @param args The directory, followed by the options of the corpus
+     */
+    void generateCorpus(std::span< const char* const > args)
+    {
+        corpus::Options options;
+        std::filesystem::path directory;
+        for (auto it = args.begin(); it != args.end(); ++it)
+        {
+            std::string_view arg = *it;
+            auto value = [&]() -> std::string
+            {
+                if (std::next(it) == args.end())
+                {
+                    throw std::runtime_error(std::format("Missing value for {}", arg));
+                }
+                return *(++it);
+            };
+
+            if (arg == "--modules")
+            {
+                options.numModules = std::stoul(value());
+            }
+            else if (arg == "--partitions")
+            {
+                options.partitionsPerModule = std::stoul(value());
+            }
+            else if (arg == "--fan-out")
+            {
+                options.fanOut = std::stod(value());
+            }
+            else if (arg == "--distribution")
+            {
+                options.distribution = corpus::parseFanOut(value());
+            }
+            else if (arg == "--scc")
+            {
+                options.sccSizes.push_back(std::stoul(value()));
+            }
+            else if (arg == "--missing")
+            {
+                options.numMissing = std::stoul(value());
+            }
+            else if (arg == "--duplicates")
+            {
+                options.numDuplicates = std::stoul(value());
+            }
+            else if (arg == "--consumers")
+            {
+                options.numConsumers = std::stoul(value());
+            }
+            else if (arg == "--seed")
+            {
+                options.seed = std::stoull(value());
+            }
+            else if (directory.empty() && !arg.starts_with("-"))
+            {
+                directory = arg;
+            }
+            else
+            {
+                throw std::runtime_error(std::format("Unexpected argument: {}", arg));
+            }
+        }
+        if (directory.empty())
+        {
+            throw std::runtime_error("Missing directory.");
+        }
+
+        auto stats = corpus::generate(directory, options);
+        std::cout << std::format("Wrote {} DDI files ({:.1f} MiB) to {}: {} modules, {} imports\n", stats.numFiles,
+                                 static_cast< double >(stats.numBytes) / (1024.0 * 1024.0), directory.string(),
+                                 stats.numModules, stats.numImports);
+    }
+
+    /**
+     * Time each phase of the mgt pipeline on generated corpora of 100, 1000, ... modules. The phases are the ones of
+     * --profile, see @ref mgt::Profile.
+     *
+     * @param maxModules The number of modules of the largest corpus
+     * @param rounds Number of runs per corpus. The mean is reported.
+     */
+    void benchScales(std::size_t maxModules, unsigned rounds)
+    {
+        auto& profile = mgt::profile();
+        profile.enable();
+
+        for (std::size_t numModules = 100; numModules <= maxModules; numModules *= 10)
+        {
+            // Something like a real code base: partitions, a few circular dependencies, missing modules, duplicate
+            // providers and as many plain translation units as modules.
+            const corpus::Options options{.numModules = numModules,
+                                          .partitionsPerModule = 1,
+                                          .fanOut = 4,
+                                          .distribution = corpus::FanOut::powerLaw,
+                                          .sccSizes = {2, 5, 20},
+                                          .numMissing = numModules / 100,
+                                          .numDuplicates = numModules / 100,
+                                          .numConsumers = numModules,
+                                          .seed = 1};
+
+            auto directory = std::filesystem::temp_directory_path() / std::format("mgt_bench_{}", numModules);
+            std::filesystem::remove_all(directory);
+            auto stats = corpus::generate(directory, options);
+
+            profile.reset();
+            const mgt::LoadOptions loadOptions{.jobs = mgt::defaultJobs(),
+                                               .cacheFile = {},
+                                               .cyclesPerSCC = 1,
+                                               .reachability = true,
+                                               .consumers = true};
+            for (unsigned round = 0; round < rounds; ++round)
+            {
+                auto graph = mgt::ModuleGraph::make(directory, loadOptions);
+                {
+                    const mgt::ScopedTimer timer("export DOT");
+                    graph.exportDOT(directory / "graph.dot");
+                }
+                {
+                    const mgt::ScopedTimer timer("snapshot");
+                    graph.saveSnapshot(directory / "graph.snap");
+                }
+            }
+
+            std::cout << std::format("{} modules ({} DDI files, {:.1f} MiB, {} imports), mean of {} rounds:\n",
+                                     numModules, stats.numFiles,
+                                     static_cast< double >(stats.numBytes) / (1024.0 * 1024.0), stats.numImports,
+                                     rounds);
+            for (const auto& phase : profile.phases())
+            {
+                auto seconds = phase.time.count() / 1000.0 / static_cast< double >(phase.calls);
+                auto isFilePhase = (phase.name == "discovery") || (phase.name == "parsing");
+                auto throughput = static_cast< double >(isFilePhase ? stats.numFiles : stats.numImports) / seconds;
+                std::cout << std::format("  {:<30} {:>10.3f} ms {:>14.0f} {}/s\n",
+                                         std::string(phase.depth * 2, ' ') + phase.name, seconds * 1000.0,
+                                         throughput, isFilePhase ? "files" : "edges");
+            }
+            std::cout << "\n";
+
+            std::filesystem::remove_all(directory);
+        }
+    }
+
+    //! The usage text.
+    constexpr std::string_view usage = R"(Usage: mgt_bench <benchmark> [args]
+
+Benchmarks:
+  parse <directory> [rounds]   Compare DDI parsers on all DDI files in the directory. All files must be valid.
+                               Default rounds: 5.
+  cycles <directory> [rounds]  Compare shortest cycle searches on the graph of the DDI files in the directory.
+                               Default rounds: 5.
+  graph <directory> [rounds]   Compare memory and runtime of the graaf and the CSR graph of the DDI files in the
+                               directory. Default rounds: 5.
+  discover <directory> [rounds]
+                               Compare the recursive directory walk with the DDI discovery. Default rounds: 5.
+  consumers <directory> [rounds]
+                               Compare memory and build time of the module graph with and without the translation
+                               units that only import modules. Default rounds: 5.
+  scales [max. modules] [rounds]
+                               Time each phase of mgt on generated corpora of 100, 1000, ... up to the given number of
+                               modules. Default: 100000 modules, 3 rounds.
+
+Corpus generator:
+  generate <directory> [options]
+                               Write a synthetic corpus of DDI files to the directory. Options:
+    --modules N                The number of modules. Default: 1000.
+    --partitions N             The number of partitions per module. Default: 0.
+    --fan-out X                The mean number of imports per module. Default: 4.
+    --distribution D           The distribution of the imports per module: fixed, uniform or power-law (default).
+    --scc N                    Plant a circular dependency of N modules. Can be given more than once.
+    --missing N                The number of imported modules without source. Default: 0.
+    --duplicates N             The number of modules provided by a second source. Default: 0.
+    --consumers N              The number of translation units that only import modules. Default: 0.
+    --seed N                   The seed of the random numbers. Default: 1.
+)";
+} // namespace
+
+int main(int argc, const char** argv)
+{
+    auto args = std::span(argv, static_cast< std::size_t >(argc)).subspan(1);
+    if (args.empty())
+    {
+        std::cerr << usage;
+        return 1;
+    }
+
+    try
+    {
+        std::string_view benchmark = args.front();
+        if ((benchmark == "parse") && (args.size() >= 2))
+        {
+            auto rounds = (args.size() >= 3) ? static_cast< unsigned >(std::stoul(args[2])) : 5U;
+            benchParse(args[1], std::max(1U, rounds));
+            return 0;
+        }
+        if ((benchmark == "cycles") && (args.size() >= 2))
+        {
+            auto rounds = (args.size() >= 3) ? static_cast< unsigned >(std::stoul(args[2])) : 5U;
+            benchCycles(args[1], std::max(1U, rounds));
+            return 0;
+        }
+        if ((benchmark == "graph") && (args.size() >= 2))
+        {
+            auto rounds = (args.size() >= 3) ? static_cast< unsigned >(std::stoul(args[2])) : 5U;
+            benchGraph(args[1], std::max(1U, rounds));
+            return 0;
+        }
+        if ((benchmark == "discover") && (args.size() >= 2))
+        {
+            auto rounds = (args.size() >= 3) ? static_cast< unsigned >(std::stoul(args[2])) : 5U;
+            benchDiscover(args[1], std::max(1U, rounds));
+            return 0;
+        }
+        if ((benchmark == "consumers") && (args.size() >= 2))
+        {
+            auto rounds = (args.size() >= 3) ? static_cast< unsigned >(std::stoul(args[2])) : 5U;
+            benchConsumers(args[1], std::max(1U, rounds));
+            return 0;
+        }
+        if (benchmark == "scales")
+        {
+            auto maxModules = (args.size() >= 2) ? std::stoul(args[1]) : 100'000UL;
+            auto rounds = (args.size() >= 3) ? static_cast< unsigned >(std::stoul(args[2])) : 3U;
+            benchScales(maxModules, std::max(1U, rounds));
+            return 0;
+        }
+        if ((benchmark == "generate") && (args.size() >= 2))
+        {
+            generateCorpus(args.subspan(1));
+            return 0;
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "ERR: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cerr << usage;
+    return 1;
+}
@@ -1,23 +1,332 @@
+#include "mgt/BuildGraph.hpp"
+#include "mgt/CommandLine.hpp"
 #include "mgt/ModuleGraph.hpp"
+#include "mgt/Profile.hpp"
+#include "mgt/Snapshot.hpp"
+#include "mgt/Watch.hpp"
 
+#include <chrono>
+#include <cstdlib>
+#include <cstddef>
+#include <exception>
 #include <filesystem>
+#include <fstream>
+#include <format>
 #include <iostream>
+#include <new>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] const char** argv)
+// Count allocations for --profile. The array versions and the nothrow versions of new and delete use these.
+void* operator new(std::size_t size)
 {
-    std::cout << "Module Graph Tool\n";
-    std::cout << "Sophia Eichelbaum" << "\n";
-    std::cout << "https://github.com/seichelbaum/module-graph-tool" << "\n\n";
+    mgt::countAllocation(size);
+    if (void* memory = std::malloc((size == 0) ? 1 : size)) // NOLINT: the allocator has to allocate.
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+// GCC cannot see that the memory was allocated with malloc in the replaced operator new.
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* memory) noexcept
+{
+    std::free(memory); // NOLINT: the allocator has to free.
+}
+
+void operator delete(void* memory, std::size_t /*size*/) noexcept
+{
+    std::free(memory); // NOLINT: the allocator has to free.
+}
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic pop
+#endif
+
+namespace
+{
+    /**
+     * Answer impact queries and print the results. See @ref mgt::ModuleGraph::impact.
+     *
+     * @param graph The graph to query. A module graph or a build graph.
+     * @param queries The queries. Each is a list of modules separated by whitespace. "-" reads one query per line from
+     * stdin.
+     */
+    template < typename Graph >
+    void queryImpact(const Graph& graph, const std::vector< std::string >& queries)
+    {
+        const mgt::ScopedTimer timer("impact");
+        std::size_t numQueries = 0;
+        std::chrono::steady_clock::duration elapsed{};
+        auto query = [&](const std::string& line)
+        {
+            std::vector< std::string > words;
+            std::istringstream stream(line);
+            for (std::string word; stream >> word;)
+            {
+                words.push_back(std::move(word));
+            }
+            if (words.empty())
+            {
+                return;
+            }
+
+            std::vector< std::string_view > modules(words.begin(), words.end());
+            auto start = std::chrono::steady_clock::now();
+            auto impact = graph.impact(modules);
+            elapsed += std::chrono::steady_clock::now() - start;
+            numQueries++;
+
+            graph.printImpact(impact);
+        };
+
+        for (const auto& queryOrStdin : queries)
+        {
+            if (queryOrStdin != "-")
+            {
+                query(queryOrStdin);
+                continue;
+            }
+            for (std::string line; std::getline(std::cin, line);)
+            {
+                query(line);
+            }
+        }
+
+        auto milliseconds = std::chrono::duration< double, std::milli >(elapsed).count();
+        std::cout << std::format("\nAnswered {} queries in {:.3f} ms\n", numQueries, milliseconds);
+    }
+
+    /**
+     * Write graph.dot and the snapshot and print the report, the critical path and the redundant imports, as requested.
+     *
+     * @param graph The graph. A module graph or a build graph.
+     * @param options The command line options
+     */
+    template < typename Graph >
+    void report(Graph& graph, const mgt::Options& options)
+    {
+        {
+            const mgt::ScopedTimer timer("export DOT");
+            graph.exportDOT("graph.dot", options.dot);
+        }
+        if (options.snapshot)
+        {
+            const mgt::ScopedTimer timer("snapshot");
+            graph.saveSnapshot(*options.snapshot);
+        }
+        {
+            const mgt::ScopedTimer timer("report");
+            graph.printReport(options.outputFormat);
+        }
+        if (options.criticalPath)
+        {
+            const mgt::ScopedTimer timer("critical path");
+            graph.printCriticalPath(options.ninjaLog);
+        }
+        if (options.redundantImports)
+        {
+            const mgt::ScopedTimer timer("redundant imports");
+            graph.printRedundantImports();
+        }
+    }
+
+    /**
+     * Print the profile and write it to profile.json, if profiling. See @ref mgt::Profile.
+     *
+     * @param options The command line options. The profile goes to stderr, if stdout is reserved for the report.
+     */
+    void reportProfile(const mgt::Options& options)
+    {
+        const auto& profile = mgt::profile();
+        if (!profile.isEnabled())
+        {
+            return;
+        }
+
+        profile.print((options.outputFormat == mgt::OutputFormat::text) ? std::cout : std::cerr);
+        std::ofstream file("profile.json", std::ios::trunc);
+        file << profile.toJSON();
+        if (!file)
+        {
+            std::cerr << "W: Failed to write profile.json\n";
+        }
+    }
+
+    /**
+     * Load the graph and answer the impact queries or write the report.
+     *
+     * @tparam Graph A module graph or a build graph
+     *
+     * @param options The command line options
+     * @param loadOptions The options to load the graph with
+     *
+     * @return The exit code
+     */
+    template < typename Graph >
+    int run(const mgt::Options& options, const mgt::LoadOptions& loadOptions)
+    {
+        try
+        {
+            auto graph = [&]
+            {
+                const mgt::ScopedTimer timer("load");
+                return Graph::make(options.location, loadOptions);
+            }();
+
+            if (options.impact.empty())
+            {
+                report(graph, options);
+            }
+            else
+            {
+                queryImpact(graph, options.impact);
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "ERR: " << e.what() << "\n";
+            return 1;
+        }
+
+        reportProfile(options);
+        return 0;
+    }
+
+    /**
+     * Keep the graph in memory and update it whenever DDI files change. Report and DOT file are only written again if
+     * the diagnostics changed.
+     *
+     * @param options The command line options
+     */
+    [[noreturn]] void watch(const mgt::Options& options)
+    {
+        // Watch before loading. Nothing that changes during the initial load gets lost this way.
+        mgt::DirectoryWatcher watcher(options.location);
+        const mgt::LoadOptions loadOptions{.jobs = options.jobs,
+                                           .cacheFile = options.cacheFile,
+                                           .cyclesPerSCC = options.cycles,
+                                           .reachability = false,
+                                           .consumers = options.consumers};
+
+        auto moduleGraph = mgt::ModuleGraph::make(options.location, loadOptions);
+        report(moduleGraph, options);
+        auto diagnostics = moduleGraph.diagnostics();
+
+        std::cout << std::format("\nWatching {} for changes. Press Ctrl+C to stop.\n", options.location.string());
+        std::cout.flush();
+        while (true)
+        {
+            // Build systems write many files in a row. Wait a moment for them to settle.
+            auto changes = watcher.wait(std::chrono::milliseconds(100));
+            auto start = std::chrono::steady_clock::now();
+
+            if (changes.overflow)
+            {
+                moduleGraph = mgt::ModuleGraph::make(options.location, loadOptions);
+            }
+            else
+            {
+                moduleGraph.update(changes.files);
+            }
+
+            auto updated = moduleGraph.diagnostics();
+            auto changed = updated != diagnostics;
+            if (changed)
+            {
+                std::cout << "\n";
+                report(moduleGraph, options);
+                diagnostics = std::move(updated);
+            }
+
+            std::cout << std::format(
+                "Update: {} in {:.2f} ms{}\n",
+                changes.overflow ? std::string("re-loaded all files") : std::format("{} file(s)", changes.files.size()),
+                std::chrono::duration< double, std::milli >(std::chrono::steady_clock::now() - start).count(),
+                changed ? "" : ", results unchanged");
+            std::cout.flush();
+        }
+    }
+} // namespace
+
+int main(int argc, const char** argv)
+{
+    mgt::Options options;
+    try
+    {
+        options = mgt::parseCommandLine(std::span(argv, static_cast< std::size_t >(argc)).subspan(1));
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "ERR: " << e.what() << "\n\n" << mgt::usage;
+        return 1;
+    }
+
+    // JSON and SARIF reports are meant to be piped into other tools. Nothing but the report goes to stdout.
+    if (options.outputFormat == mgt::OutputFormat::text)
+    {
+        std::cout << "Module Graph Tool\n";
+        std::cout << "Sophia Eichelbaum" << "\n";
+        std::cout << "https://github.com/seichelbaum/module-graph-tool" << "\n\n";
+    }
+
+    if (options.help)
+    {
+        std::cout << mgt::usage;
+        return 0;
+    }
+
+    if (options.profile)
+    {
+        mgt::profile().enable();
+    }
+
+    if (options.diff)
+    {
+        try
+        {
+            auto before = mgt::Snapshot::load(options.diff->first);
+            auto after = mgt::Snapshot::load(options.diff->second);
+            std::cout << std::format("Diff of {} ({} modules, {} imports) and {} ({} modules, {} imports)\n\n",
+                                     options.diff->first.string(), before.numModules(), before.numEdges(),
+                                     options.diff->second.string(), after.numModules(), after.numEdges());
+            auto changes = mgt::diff(before, after);
+            mgt::printDiff(changes);
+            return changes.hasNewErrors() ? 1 : 0;
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "ERR: " << e.what() << "\n";
+            return 1;
+        }
+    }
 
-    auto location = std::filesystem::current_path();
-    if (argc == 2)
+    if (options.watch)
     {
-        location = std::filesystem::path(argv[1]); // NOLINT: pointer arithmetic is acceptable here.
+        try
+        {
+            watch(options);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "ERR: " << e.what() << "\n";
+            return 1;
+        }
     }
 
-    auto moduleGraph = mgt::ModuleGraph::make(location);
-    moduleGraph.exportDOT("graph.dot");
-    moduleGraph.printReport();
+    const mgt::LoadOptions loadOptions{.jobs = options.jobs,
+                                       .cacheFile = options.cacheFile,
+                                       .cyclesPerSCC = options.cycles,
+                                       .reachability = !options.impact.empty(),
+                                       .consumers = options.consumers};
 
-    return 0;
+    return options.allTargets ? run< mgt::BuildGraph >(options, loadOptions)
+                              : run< mgt::ModuleGraph >(options, loadOptions);
 }
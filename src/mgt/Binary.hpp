@@ -0,0 +1,179 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace mgt
+{
+    /**
+     * FNV-1a hash of a sequence of bytes. Used where hashes are persisted, as std::hash is not guaranteed to be stable
+     * between runs or standard library versions.
+     *
+     * @param data The bytes to hash
+     * @param seed The hash to continue from. Use the default to start a new hash.
+     *
+     * @return The hash
+     */
+    [[nodiscard]] constexpr std::uint64_t hashBytes(std::string_view data,
+                                                    std::uint64_t seed = 0xcbf29ce484222325ULL) noexcept
+    {
+        constexpr std::uint64_t prime = 0x100000001b3ULL;
+        auto hash = seed;
+        for (auto c : data)
+        {
+            hash ^= static_cast< unsigned char >(c);
+            hash *= prime;
+        }
+        return hash;
+    }
+
+    /**
+     * Writes plain values into a byte buffer. All values are stored little-endian, independent of the platform.
+     */
+    class BinaryWriter
+    {
+    public:
+        //! Write an integer
+        template < typename T >
+            requires std::is_integral_v< T >
+        void write(T value)
+        {
+            if constexpr (std::endian::native == std::endian::big)
+            {
+                value = std::byteswap(value);
+            }
+
+            char bytes[sizeof(T)]; // NOLINT: plain byte buffer.
+            std::memcpy(bytes, &value, sizeof(T));
+            m_buffer.append(bytes, sizeof(T));
+        }
+
+        //! Write a string with its length
+        void write(std::string_view str)
+        {
+            write(static_cast< std::uint32_t >(str.size()));
+            m_buffer.append(str);
+        }
+
+        //! Write raw bytes, without length
+        void writeBytes(std::string_view bytes)
+        {
+            m_buffer.append(bytes);
+        }
+
+        //! Write a size or count. Stored as 32 bit.
+        void writeSize(std::size_t size)
+        {
+            write(static_cast< std::uint32_t >(size));
+        }
+
+        //! The written data
+        [[nodiscard]] const std::string& buffer() const
+        {
+            return m_buffer;
+        }
+
+    private:
+        //! The written bytes
+        std::string m_buffer;
+    };
+
+    /**
+     * Reads values written by @ref BinaryWriter. All reads are bounds-checked.
+     */
+    class BinaryReader
+    {
+    public:
+        /**
+         * Create a reader.
+         *
+         * @param data The data. Must outlive the reader.
+         */
+        explicit BinaryReader(std::string_view data) : m_data(data)
+        {
+        }
+
+        /**
+         * Read an integer.
+         *
+         * @throw std::runtime_error If the data is truncated.
+         */
+        template < typename T >
+            requires std::is_integral_v< T >
+        [[nodiscard]] T read()
+        {
+            auto bytes = take(sizeof(T));
+            T value{};
+            std::memcpy(&value, bytes.data(), sizeof(T));
+            if constexpr (std::endian::native == std::endian::big)
+            {
+                value = std::byteswap(value);
+            }
+            return value;
+        }
+
+        /**
+         * Read a string. The view points into the data.
+         *
+         * @throw std::runtime_error If the data is truncated.
+         */
+        [[nodiscard]] std::string_view readString()
+        {
+            return take(read< std::uint32_t >());
+        }
+
+        /**
+         * Read a size or count and check it against an upper bound. Protects against allocating absurd amounts of
+         * memory for corrupted files.
+         *
+         * @throw std::runtime_error If the data is truncated or the value exceeds the bound.
+         *
+         * @param limit The max. allowed value.
+         */
+        [[nodiscard]] std::size_t readSize(std::size_t limit = std::numeric_limits< std::uint32_t >::max())
+        {
+            auto size = static_cast< std::size_t >(read< std::uint32_t >());
+            if (size > limit)
+            {
+                throw std::runtime_error("Invalid size.");
+            }
+            return size;
+        }
+
+        /**
+         * Get the given number of raw bytes.
+         *
+         * @throw std::runtime_error If the data is truncated.
+         */
+        [[nodiscard]] std::string_view take(std::size_t size)
+        {
+            if (size > m_data.size() - m_pos)
+            {
+                throw std::runtime_error("Unexpected end of data.");
+            }
+            auto result = m_data.substr(m_pos, size);
+            m_pos += size;
+            return result;
+        }
+
+        //! True if all data was read.
+        [[nodiscard]] bool atEnd() const
+        {
+            return m_pos == m_data.size();
+        }
+
+    private:
+        //! The data
+        std::string_view m_data;
+
+        //! The read position
+        std::size_t m_pos = 0;
+    };
+} // namespace mgt
@@ -0,0 +1,460 @@
+#pragma once
+
+#include "Cache.hpp"
+#include "DDI.hpp"
+#include "Discovery.hpp"
+#include "Interner.hpp"
+#include "ModuleGraph.hpp"
+#include "Parallel.hpp"
+#include "Report.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    /**
+     * All targets of a CMake build directory. Each target keeps its DDI files in its own CMakeFiles/<target>.dir
+     * directory. The DDI files of all targets are loaded once, into one shared set of symbol tables. Each target gets
+     * its own @ref ModuleGraph built out of its share of the DDI. Additionally, a combined graph of all targets is
+     * built to find the issues that single targets cannot see: circular dependencies across targets and modules that
+     * are provided by more than one target.
+     */
+    class BuildGraph
+    {
+    public:
+        /**
+         * Find all targets in a build directory and load their DDI files.
+         *
+         * @throw std::runtime_error If the build directory does not exist.
+         *
+         * @param buildDir The CMake build directory
+         * @param options Control the loading process. See @ref LoadOptions.
+         *
+         * @return The graph of all targets
+         */
+        [[nodiscard]] static BuildGraph make(const std::filesystem::path& buildDir, const LoadOptions& options = {})
+        {
+            if (!std::filesystem::is_directory(buildDir))
+            {
+                throw std::runtime_error(std::format("Not a directory: {}", buildDir.string()));
+            }
+
+            auto symbols = std::make_shared< Symbols >();
+
+            AnalysisCache cache;
+            if (options.cacheFile)
+            {
+                const ScopedTimer timer("cache: load");
+                cache = AnalysisCache::load(*options.cacheFile, *symbols);
+            }
+
+            // One walk and one pool of workers for all targets.
+            auto loaded = ddi::load(buildDir, *symbols, options.jobs,
+                                    options.cacheFile ? cache.lookup() : ddi::CacheLookup{});
+
+            // Group the DDI by target, so the DDI of each target are a contiguous range. DDI outside of any target
+            // directory go last. They are only part of the combined graph.
+            auto directories = findTargets(buildDir);
+            std::vector< std::vector< ddi::DDI > > buckets(directories.size() + 1);
+            for (auto& ddi : loaded.ddis)
+            {
+                auto target = targetOf(ddi.path, directories).value_or(directories.size());
+                buckets[target].push_back(std::move(ddi));
+            }
+
+            loaded.ddis.clear();
+            std::vector< std::size_t > offsets;
+            for (auto& bucket : buckets)
+            {
+                offsets.push_back(loaded.ddis.size());
+                std::ranges::move(bucket, std::back_inserter(loaded.ddis));
+            }
+            offsets.push_back(loaded.ddis.size());
+
+            // Views into loaded.ddis. It does not change anymore.
+            std::vector< std::span< const ddi::DDI > > perTarget;
+            for (std::size_t i = 0; i < directories.size(); ++i)
+            {
+                perTarget.push_back(std::span(loaded.ddis).subspan(offsets[i], offsets[i + 1] - offsets[i]));
+            }
+
+            // The targets are independent of each other. Build them in parallel instead of parallelizing each one.
+            std::vector< std::optional< ModuleGraph > > graphs(directories.size());
+            {
+                const ScopedTimer timer("targets");
+                parallelFor(directories.size(), options.jobs,
+                            [&](std::size_t i, unsigned)
+                            {
+                                const LoadOptions targetOptions{.jobs = 1,
+                                                                .cacheFile = {},
+                                                                .cyclesPerSCC = options.cyclesPerSCC,
+                                                                .reachability = false,
+                                                                .consumers = options.consumers};
+                                graphs[i] = ModuleGraph::make(directories[i], symbols, perTarget[i], targetOptions);
+                            });
+            }
+
+            std::optional< ModuleGraph > combined;
+            {
+                const ScopedTimer timer("combined graph");
+                combined = ModuleGraph::make(buildDir, symbols, loaded.ddis, options, &cache);
+            }
+
+            BuildGraph result(buildDir, std::move(*combined));
+            result.m_symbols = symbols;
+            result.m_numTargetDirectories = directories.size();
+            result.m_numFiles = loaded.ddis.size();
+            for (std::size_t i = 0; i < directories.size(); ++i)
+            {
+                // Targets without modules are of no interest.
+                if (perTarget[i].empty())
+                {
+                    continue;
+                }
+
+                auto index = result.m_targets.size();
+                result.m_targets.push_back({.name = directories[i].stem().string(),
+                                            .directory = directories[i],
+                                            .numFiles = perTarget[i].size(),
+                                            .graph = std::move(*graphs[i])});
+
+                for (const auto& ddi : perTarget[i])
+                {
+                    for (const auto& rule : ddi.rules)
+                    {
+                        for (const auto& provide : rule.provides)
+                        {
+                            result.m_providers[symbols->modules.view(provide.logicalName)].emplace(
+                                index, symbols->paths.view(provide.sourcePath));
+                        }
+                    }
+                }
+            }
+
+            if (options.cacheFile)
+            {
+                result.m_cacheStats = {.hits = loaded.cacheHits, .misses = loaded.cacheMisses};
+                const ScopedTimer timer("cache: save");
+                result.m_combined.saveCache(cache, loaded.ddis, *options.cacheFile);
+            }
+            result.m_loadTimes = loaded.times;
+
+            return result;
+        }
+
+        /**
+         * Find the target directories of a CMake build directory. These are the CMakeFiles/<target>.dir directories of
+         * the build directory and all its sub-directories. CMake keeps a list of them. Only if that is missing, the
+         * directory tree is searched.
+         *
+         * @param buildDir The build directory
+         *
+         * @return The target directories, sorted.
+         */
+        [[nodiscard]] static std::vector< std::filesystem::path > findTargets(const std::filesystem::path& buildDir)
+        {
+            if (auto directories = ddi::targetDirectories(buildDir))
+            {
+                return std::move(*directories);
+            }
+
+            std::vector< std::filesystem::path > result;
+            for (auto it = std::filesystem::recursive_directory_iterator(buildDir);
+                 it != std::filesystem::recursive_directory_iterator(); ++it)
+            {
+                const auto& path = it->path();
+                if (it->is_directory() && (path.extension() == ".dir") &&
+                    (path.parent_path().filename() == "CMakeFiles"))
+                {
+                    result.push_back(path);
+                    // Targets do not nest.
+                    it.disable_recursion_pending();
+                }
+            }
+            std::ranges::sort(result);
+            return result;
+        }
+
+        /**
+         * Collect a combined report of all targets. Circular dependencies are reported per target and, if they span
+         * multiple targets, for the whole build. A module is only reported as missing if no target provides it. The
+         * report refers to the names of this build.
+         */
+        [[nodiscard]] Report report() const
+        {
+            Report result;
+            auto& summary = result.summary();
+            summary.path = m_path.string();
+            summary.numFiles = m_numFiles;
+            summary.loadTimes = m_loadTimes;
+            if (m_cacheStats)
+            {
+                summary.cacheStats = {.hits = m_cacheStats->hits, .misses = m_cacheStats->misses};
+            }
+            summary.numModules = m_combined.numModules();
+            summary.numTargetDirectories = m_numTargetDirectories;
+            for (const auto& target : m_targets)
+            {
+                summary.targets.push_back(
+                    {.name = target.name, .numFiles = target.numFiles, .numModules = target.graph.numModules()});
+            }
+
+            // Multiple sources for a module? Within a single target or across targets.
+            for (const auto& [module, providers] : m_providers)
+            {
+                auto firstTarget = providers.begin()->first;
+                auto isMultipleTargets =
+                    std::ranges::any_of(providers, [&](const auto& provider) { return provider.first != firstTarget; });
+                if (isMultipleTargets)
+                {
+                    result.add(codes::multipleTargets, module);
+                    for (const auto& [target, source] : providers)
+                    {
+                        result.addSource(source, m_targets[target].name);
+                    }
+                }
+                else if (providers.size() > 1)
+                {
+                    // Sorted by target and source, hence no source appears twice.
+                    result.add(codes::multipleSources, module, m_targets[firstTarget].name);
+                    for (const auto& provider : providers)
+                    {
+                        result.addSource(provider.second);
+                    }
+                }
+            }
+
+            // Modules a target imports from another target are fine. Only those provided by no target are missing.
+            auto combined = m_combined.diagnostics();
+            for (const auto& module : combined.missing)
+            {
+                result.add(codes::missingModule, module);
+            }
+
+            auto addCircularDependency = [&](const std::vector< ModuleId >& scc,
+                                             const std::vector< std::vector< ModuleId > >& cycles)
+            {
+                auto names = std::views::transform([&](ModuleId id) { return m_symbols->modules.view(id); });
+                result.setModules(scc | names);
+                for (const auto& cycle : cycles)
+                {
+                    result.addCycle(cycle | names);
+                }
+            };
+
+            // Circular dependencies within a target
+            std::set< std::vector< ModuleId > > reported;
+            for (const auto& target : m_targets)
+            {
+                auto analysis = target.graph.analysis();
+                for (std::size_t i = 0; i < analysis.sccs.size(); ++i)
+                {
+                    result.add(codes::circularDependency, {}, target.name);
+                    addCircularDependency(analysis.sccs[i], analysis.cycles[i]);
+                    reported.insert(sorted(analysis.sccs[i]));
+                }
+            }
+
+            // Circular dependencies that only exist when looking at all targets at once
+            auto analysis = m_combined.analysis();
+            for (std::size_t i = 0; i < analysis.sccs.size(); ++i)
+            {
+                if (reported.contains(sorted(analysis.sccs[i])))
+                {
+                    continue;
+                }
+
+                std::set< std::string_view > targets;
+                for (auto module : analysis.sccs[i])
+                {
+                    if (auto it = m_providers.find(m_symbols->modules.view(module)); it != m_providers.end())
+                    {
+                        for (const auto& [target, _] : it->second)
+                        {
+                            targets.insert(m_targets[target].name);
+                        }
+                    }
+                }
+
+                result.add(codes::circularDependency);
+                for (auto target : targets)
+                {
+                    result.addTarget(target);
+                }
+                addCircularDependency(analysis.sccs[i], analysis.cycles[i]);
+            }
+
+            return result;
+        }
+
+        /**
+         * Prints a combined report of all targets. See @ref report.
+         *
+         * @param format The format to print in
+         */
+        void printReport(OutputFormat format = OutputFormat::text) const
+        {
+            report().write(std::cout, format);
+        }
+
+        /**
+         * Prints the critical path of the whole build. See @ref ModuleGraph::printCriticalPath.
+         *
+         * @param ninjaLog Optional. Weight each module with its compile time from this log.
+         */
+        void printCriticalPath(const std::optional< std::filesystem::path >& ninjaLog) const
+        {
+            m_combined.printCriticalPath(ninjaLog);
+        }
+
+        /**
+         * Prints the redundant imports of the whole build. See @ref ModuleGraph::printRedundantImports.
+         */
+        void printRedundantImports() const
+        {
+            m_combined.printRedundantImports();
+        }
+
+        /**
+         * What has to be rebuilt in the whole build if the given modules change. See @ref ModuleGraph::impact.
+         *
+         * @param modules The names of the changed modules
+         */
+        [[nodiscard]] ModuleGraph::Impact impact(std::span< const std::string_view > modules) const
+        {
+            return m_combined.impact(modules);
+        }
+
+        /**
+         * Prints the result of @ref impact.
+         *
+         * @param impact The impact of a change
+         */
+        void printImpact(const ModuleGraph::Impact& impact) const
+        {
+            m_combined.printImpact(impact);
+        }
+
+        /**
+         * Export the combined graph of all targets as DOT file.
+         *
+         * @param file The file to write to
+         * @param options How much detail to export
+         */
+        void exportDOT(const std::filesystem::path& file, const DotOptions& options = {}) const
+        {
+            m_combined.exportDOT(file, options);
+        }
+
+        /**
+         * Write a snapshot of the combined graph of all targets. See @ref ModuleGraph::saveSnapshot.
+         *
+         * @param file The file to write to
+         */
+        void saveSnapshot(const std::filesystem::path& file) const
+        {
+            m_combined.saveSnapshot(file);
+        }
+
+    private:
+        //! A target of the build and its modules.
+        struct Target
+        {
+            //! The name of the target, as used by CMake
+            std::string name;
+            //! The CMakeFiles/<target>.dir directory
+            std::filesystem::path directory;
+            //! The number of DDI files of the target
+            std::size_t numFiles = 0;
+            //! The graph of the modules of this target only
+            ModuleGraph graph;
+        };
+
+        //! The interned module names and paths of all targets
+        std::shared_ptr< Symbols > m_symbols;
+
+        //! The targets that have modules, sorted by their directory.
+        std::vector< Target > m_targets;
+
+        //! The graph of all DDI of the build directory
+        ModuleGraph m_combined;
+
+        //! Per provided module: the targets (index into m_targets) and sources that provide it. Keyed and sorted by
+        //! names, not by IDs: the IDs depend on the order the parser threads interned the names in, and the report
+        //! has to be the same for every run.
+        std::map< std::string_view, std::set< std::pair< std::size_t, std::string_view > > > m_providers;
+
+        //! The number of target directories, including those without modules.
+        std::size_t m_numTargetDirectories = 0;
+
+        //! The number of DDI files of all targets
+        std::size_t m_numFiles = 0;
+
+        //! Cache statistics of the DDI loading
+        struct CacheStats
+        {
+            std::size_t hits = 0;
+            std::size_t misses = 0;
+        };
+
+        //! The cache statistics. Only set if a cache was used.
+        std::optional< CacheStats > m_cacheStats;
+
+        //! How long it took to find and load the DDI files
+        ddi::LoadTimes m_loadTimes;
+
+        //! The build directory
+        std::filesystem::path m_path;
+
+        //! Values are calculated and filled by @ref make
+        BuildGraph(std::filesystem::path path, ModuleGraph combined)
+            : m_combined(std::move(combined)), m_path(std::move(path))
+        {
+        }
+
+        /**
+         * Find the target a DDI file belongs to.
+         *
+         * @param file The DDI file
+         * @param directories The target directories, sorted.
+         *
+         * @return The index of the target directory that contains the file, if any.
+         */
+        [[nodiscard]] static std::optional< std::size_t > targetOf(const std::filesystem::path& file,
+                                                                   std::span< const std::filesystem::path > directories)
+        {
+            for (auto directory = file.parent_path(); directory.has_relative_path();
+                 directory = directory.parent_path())
+            {
+                if (auto it = std::ranges::lower_bound(directories, directory);
+                    (it != directories.end()) && (*it == directory))
+                {
+                    return static_cast< std::size_t >(it - directories.begin());
+                }
+            }
+            return std::nullopt;
+        }
+
+        //! A sorted copy of a list of modules
+        [[nodiscard]] static std::vector< ModuleId > sorted(std::vector< ModuleId > modules)
+        {
+            std::ranges::sort(modules);
+            return modules;
+        }
+    };
+} // namespace mgt
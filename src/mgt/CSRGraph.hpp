@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    //! A vertex of a @ref CSRGraph. Vertices are numbered densely, from 0 to numVertices - 1.
+    using VertexId = std::uint32_t;
+
+    //! A directed edge between two vertices: (from, to)
+    using GraphEdge = std::pair< VertexId, VertexId >;
+
+    /**
+     * An immutable directed graph in compressed sparse row format. The successors of all vertices are stored in one
+     * contiguous array, the successors of vertex v in [offsets[v], offsets[v + 1]). The same is stored for the reverse
+     * edges, to get the predecessors of a vertex.
+     *
+     * The graph is built once from a list of edges. Duplicate edges are removed, the neighbours of each vertex are
+     * sorted.
+     */
+    class CSRGraph
+    {
+    public:
+        //! An empty graph
+        CSRGraph() = default;
+
+        /**
+         * Build the graph.
+         *
+         * @throw std::out_of_range If an edge references a vertex >= numVertices.
+         *
+         * @param numVertices The number of vertices
+         * @param edges The edges. Duplicates are allowed.
+         */
+        CSRGraph(std::size_t numVertices, std::vector< GraphEdge > edges)
+        {
+            for (const auto& [from, to] : edges)
+            {
+                if ((from >= numVertices) || (to >= numVertices))
+                {
+                    throw std::out_of_range(
+                        std::format("Edge {} -> {} references a vertex >= {}", from, to, numVertices));
+                }
+            }
+
+            // Edges built in parallel arrive sorted already.
+            if (!std::ranges::is_sorted(edges))
+            {
+                std::ranges::sort(edges);
+            }
+            auto [first, last] = std::ranges::unique(edges);
+            edges.erase(first, last);
+
+            fill(numVertices, edges, &GraphEdge::first, &GraphEdge::second, m_offsets, m_targets);
+
+            // The edges are sorted by source, and a counting sort is stable. So the predecessors end up sorted too.
+            fill(numVertices, edges, &GraphEdge::second, &GraphEdge::first, m_reverseOffsets, m_sources);
+        }
+
+        //! The number of vertices
+        [[nodiscard]] std::size_t numVertices() const
+        {
+            return m_offsets.empty() ? 0 : m_offsets.size() - 1;
+        }
+
+        //! The number of (distinct) edges
+        [[nodiscard]] std::size_t numEdges() const
+        {
+            return m_targets.size();
+        }
+
+        //! The targets of the edges leaving the given vertex, sorted.
+        [[nodiscard]] std::span< const VertexId > successors(VertexId vertex) const
+        {
+            return std::span(m_targets).subspan(m_offsets[vertex], m_offsets[vertex + 1] - m_offsets[vertex]);
+        }
+
+        //! The sources of the edges entering the given vertex, sorted.
+        [[nodiscard]] std::span< const VertexId > predecessors(VertexId vertex) const
+        {
+            return std::span(m_sources)
+                .subspan(m_reverseOffsets[vertex], m_reverseOffsets[vertex + 1] - m_reverseOffsets[vertex]);
+        }
+
+        //! The number of edges leaving the given vertex
+        [[nodiscard]] std::size_t outDegree(VertexId vertex) const
+        {
+            return m_offsets[vertex + 1] - m_offsets[vertex];
+        }
+
+        //! The number of edges entering the given vertex
+        [[nodiscard]] std::size_t inDegree(VertexId vertex) const
+        {
+            return m_reverseOffsets[vertex + 1] - m_reverseOffsets[vertex];
+        }
+
+        //! Check if there is an edge from -> to. O(log(outDegree(from))).
+        [[nodiscard]] bool hasEdge(VertexId from, VertexId to) const
+        {
+            return std::ranges::binary_search(successors(from), to);
+        }
+
+        //! All edges, sorted by source and target.
+        [[nodiscard]] std::vector< GraphEdge > edges() const
+        {
+            std::vector< GraphEdge > result;
+            result.reserve(numEdges());
+            for (VertexId from = 0; from < numVertices(); ++from)
+            {
+                for (auto to : successors(from))
+                {
+                    result.emplace_back(from, to);
+                }
+            }
+            return result;
+        }
+
+        //! The number of bytes used by the graph's arrays.
+        [[nodiscard]] std::size_t memoryUsage() const
+        {
+            return sizeof(VertexId) *
+                   (m_offsets.capacity() + m_targets.capacity() + m_reverseOffsets.capacity() + m_sources.capacity());
+        }
+
+    private:
+        //! Per vertex: offset of its first successor in m_targets. One more entry at the end.
+        std::vector< VertexId > m_offsets;
+
+        //! The successors of all vertices
+        std::vector< VertexId > m_targets;
+
+        //! Per vertex: offset of its first predecessor in m_sources. One more entry at the end.
+        std::vector< VertexId > m_reverseOffsets;
+
+        //! The predecessors of all vertices
+        std::vector< VertexId > m_sources;
+
+        /**
+         * Counting sort of the edges into CSR arrays.
+         *
+         * @param numVertices The number of vertices
+         * @param edges The edges
+         * @param key Selects the vertex the edge belongs to
+         * @param value Selects the vertex to store
+         * @param offsets Receives the offsets
+         * @param values Receives the values
+         */
+        static void fill(std::size_t numVertices, const std::vector< GraphEdge >& edges, VertexId GraphEdge::* key,
+                         VertexId GraphEdge::* value, std::vector< VertexId >& offsets, std::vector< VertexId >& values)
+        {
+            offsets.assign(numVertices + 1, 0);
+            for (const auto& edge : edges)
+            {
+                ++offsets[edge.*key + 1];
+            }
+            for (std::size_t i = 1; i < offsets.size(); ++i)
+            {
+                offsets[i] += offsets[i - 1];
+            }
+
+            values.resize(edges.size());
+            auto next = offsets;
+            for (const auto& edge : edges)
+            {
+                values[next[edge.*key]++] = edge.*value;
+            }
+        }
+    };
+} // namespace mgt
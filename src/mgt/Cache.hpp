@@ -0,0 +1,453 @@
+#pragma once
+
+#include "Binary.hpp"
+#include "DDI.hpp"
+#include "Interner.hpp"
+#include "MappedFile.hpp"
+#include "Reachability.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    //! A directed edge between two modules. As in the module graph, the first module requires the second one.
+    using ModuleEdge = std::pair< ModuleId, ModuleId >;
+
+    /**
+     * A persistent cache of the DDI files loaded by a previous run and of the analysis results of that run. The cache
+     * is stored in a compact binary file. All names are stored as strings, as the interned IDs are only valid within a
+     * run.
+     *
+     * DDI files are identified by their path relative to the root directory they were loaded from. Cached rules are
+     * re-used if size and modification time match, or if the content hash matches.
+     */
+    class AnalysisCache
+    {
+    public:
+        //! The results of the graph analysis. They only depend on the edges of the graph.
+        struct Analysis
+        {
+            //! All edges of the graph, sorted.
+            std::vector< ModuleEdge > edges;
+            //! The max. number of cycles that was searched per SCC
+            std::size_t cyclesPerSCC = 1;
+            //! The SCCs (excluding single nodes)
+            std::vector< std::vector< ModuleId > > sccs;
+            //! The shortest cycles per SCC. Same order as sccs.
+            std::vector< std::vector< std::vector< ModuleId > > > cycles;
+            //! The reachability index, labeled with module IDs. Only set if it was built.
+            std::optional< ReachabilityIndex > reachability;
+        };
+
+        /**
+         * Load a cache file. A missing, outdated or corrupted cache file results in an empty cache.
+         *
+         * @param file The cache file
+         * @param symbols The symbol tables to intern all names into.
+         *
+         * @return The cache
+         */
+        [[nodiscard]] static AnalysisCache load(const std::filesystem::path& file, Symbols& symbols)
+        {
+            AnalysisCache result;
+            if (!std::filesystem::exists(file))
+            {
+                return result;
+            }
+
+            try
+            {
+                const MappedFile mapped(file);
+                result.read(mapped.view(), symbols);
+            }
+            catch (std::exception&)
+            {
+                // Whatever went wrong, the cache is not usable. Start from scratch.
+                result = AnalysisCache{};
+            }
+
+            return result;
+        }
+
+        /**
+         * Write the cache file.
+         *
+         * @throw std::runtime_error If the file cannot be written.
+         *
+         * @param file The cache file
+         * @param symbols The symbol tables all IDs refer to
+         */
+        void save(const std::filesystem::path& file, const Symbols& symbols) const
+        {
+            // Write to a temporary file first. A crash while writing should not leave a corrupted cache behind.
+            auto temporary = file;
+            temporary += ".tmp";
+            {
+                std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+                const auto& data = write(symbols);
+                out.write(data.data(), static_cast< std::streamsize >(data.size()));
+                if (!out)
+                {
+                    throw std::runtime_error(std::format("Cannot write {}", temporary.string()));
+                }
+            }
+            std::filesystem::rename(temporary, file);
+        }
+
+        /**
+         * A lookup function to pass to @ref ddi::load. Valid as long as this cache lives and is not modified.
+         */
+        [[nodiscard]] ddi::CacheLookup lookup() const
+        {
+            return [this](const std::filesystem::path& relativePath, const ddi::FileStamp& stamp) -> const ddi::DDI*
+            {
+                auto it = m_files.find(relativePath.generic_string());
+                if (it == m_files.end())
+                {
+                    return nullptr;
+                }
+
+                const auto& cached = it->second.stamp;
+                auto sameFile = (cached.size == stamp.size) && (cached.mtime == stamp.mtime);
+                auto sameContent = (stamp.hash != 0) && (cached.size == stamp.size) && (cached.hash == stamp.hash);
+                return (sameFile || sameContent) ? &it->second : nullptr;
+            };
+        }
+
+        /**
+         * Get the cached analysis results, if they were made for the given edges.
+         *
+         * @param edges The current edges of the graph, sorted.
+         * @param cyclesPerSCC The max. number of cycles per SCC the analysis has to provide.
+         *
+         * @return The analysis or nullptr if there is none or if edges or number of cycles differ.
+         */
+        [[nodiscard]] const Analysis* analysis(const std::vector< ModuleEdge >& edges, std::size_t cyclesPerSCC) const
+        {
+            auto matches = m_analysis.has_value() && (m_analysis->cyclesPerSCC == cyclesPerSCC) &&
+                           (m_analysis->edges == edges);
+            return matches ? &m_analysis.value() : nullptr;
+        }
+
+        /**
+         * Check if the cache is up to date with the given DDI.
+         *
+         * @param ddis The DDI of the current run
+         *
+         * @return True if exactly these files with exactly these stamps are cached.
+         */
+        [[nodiscard]] bool isCurrent(const std::vector< ddi::DDI >& ddis) const
+        {
+            if (ddis.size() != m_files.size())
+            {
+                return false;
+            }
+
+            return std::ranges::all_of(ddis,
+                                       [&](const auto& ddi)
+                                       {
+                                           auto it = m_files.find(key(ddi));
+                                           return (it != m_files.end()) && (it->second.stamp.size == ddi.stamp.size) &&
+                                                  (it->second.stamp.mtime == ddi.stamp.mtime) &&
+                                                  (it->second.stamp.hash == ddi.stamp.hash);
+                                       });
+        }
+
+        /**
+         * Replace the cache contents.
+         *
+         * @param ddis The DDI of the current run
+         * @param analysis The analysis results of the current run
+         */
+        void update(const std::vector< ddi::DDI >& ddis, Analysis analysis)
+        {
+            m_files.clear();
+            for (const auto& ddi : ddis)
+            {
+                m_files.insert_or_assign(key(ddi), ddi);
+            }
+            m_analysis = std::move(analysis);
+        }
+
+    private:
+        //! Identifies the cache file format
+        static constexpr std::string_view magic = "MGTCACHE";
+
+        //! Increment whenever the format changes. Older cache files are ignored.
+        static constexpr std::uint32_t formatVersion = 4;
+
+        //! The cached DDI files, by their generic path relative to the root.
+        std::unordered_map< std::string, ddi::DDI > m_files;
+
+        //! The cached analysis results
+        std::optional< Analysis > m_analysis;
+
+        //! The key of a DDI in m_files
+        [[nodiscard]] static std::string key(const ddi::DDI& ddi)
+        {
+            return ddi.path.lexically_relative(ddi.root).generic_string();
+        }
+
+        /**
+         * Serialize the cache.
+         *
+         * Layout: magic, version, module name table, path table, files (path, stamp, rules), analysis (edges, number
+         * of cycles per SCC, SCCs, cycles, reachability index). Names and paths are stored as indices into the tables.
+         */
+        [[nodiscard]] std::string write(const Symbols& symbols) const
+        {
+            // Map the IDs of this run to compact table indices.
+            struct Table
+            {
+                const Interner& interner;
+                std::unordered_map< SymbolId, std::uint32_t > index;
+                std::vector< SymbolId > ids;
+
+                std::uint32_t operator()(SymbolId id)
+                {
+                    auto [it, inserted] = index.try_emplace(id, static_cast< std::uint32_t >(ids.size()));
+                    if (inserted)
+                    {
+                        ids.push_back(id);
+                    }
+                    return it->second;
+                }
+            };
+
+            Table modules{.interner = symbols.modules, .index = {}, .ids = {}};
+            Table paths{.interner = symbols.paths, .index = {}, .ids = {}};
+
+            // The body first, to collect the strings
+            BinaryWriter body;
+            body.writeSize(m_files.size());
+            for (const auto& [relativePath, ddi] : m_files)
+            {
+                body.write(relativePath);
+                body.write(ddi.stamp.size);
+                body.write(ddi.stamp.mtime);
+                body.write(ddi.stamp.hash);
+                body.write(static_cast< std::int32_t >(ddi.version));
+                body.write(static_cast< std::int32_t >(ddi.revision));
+
+                body.writeSize(ddi.rules.size());
+                for (const auto& rule : ddi.rules)
+                {
+                    body.write(paths(rule.primaryOutput));
+                    body.writeSize(rule.provides.size());
+                    for (const auto& provide : rule.provides)
+                    {
+                        body.write(modules(provide.logicalName));
+                        body.write(paths(provide.sourcePath));
+                    }
+                    body.writeSize(rule.requires_.size());
+                    for (const auto& require : rule.requires_)
+                    {
+                        body.write(modules(require.logicalName));
+                    }
+                }
+            }
+
+            auto writeLists = [&](const auto& lists)
+            {
+                body.writeSize(lists.size());
+                for (const auto& list : lists)
+                {
+                    body.writeSize(list.size());
+                    for (const auto& id : list)
+                    {
+                        body.write(modules(id));
+                    }
+                }
+            };
+
+            body.write(static_cast< std::uint8_t >(m_analysis.has_value()));
+            if (m_analysis)
+            {
+                body.writeSize(m_analysis->edges.size());
+                for (const auto& [from, to] : m_analysis->edges)
+                {
+                    body.write(modules(from));
+                    body.write(modules(to));
+                }
+                body.writeSize(m_analysis->cyclesPerSCC);
+                writeLists(m_analysis->sccs);
+                body.writeSize(m_analysis->cycles.size());
+                for (const auto& cycles : m_analysis->cycles)
+                {
+                    writeLists(cycles);
+                }
+
+                const auto& index = m_analysis->reachability;
+                body.write(static_cast< std::uint8_t >(index.has_value()));
+                if (index)
+                {
+                    body.writeSize(index->size());
+                    for (auto id : index->order())
+                    {
+                        body.write(modules(id));
+                    }
+                    for (auto offset : index->offsets())
+                    {
+                        body.write(offset);
+                    }
+                    body.writeSize(index->ranges().size());
+                    for (const auto& range : index->ranges())
+                    {
+                        body.write(range.first);
+                        body.write(range.last);
+                    }
+                }
+            }
+
+            // Then the header and tables.
+            BinaryWriter out;
+            out.writeBytes(magic);
+            out.write(formatVersion);
+            for (const auto* table : {&modules, &paths})
+            {
+                out.writeSize(table->ids.size());
+                for (auto id : table->ids)
+                {
+                    out.write(table->interner.view(id));
+                }
+            }
+
+            return out.buffer() + body.buffer();
+        }
+
+        /**
+         * Deserialize the cache. See @ref write for the layout.
+         *
+         * @throw std::runtime_error If the data is not a valid cache.
+         */
+        void read(std::string_view data, Symbols& symbols)
+        {
+            BinaryReader in(data);
+            if ((in.take(magic.size()) != magic) || (in.read< std::uint32_t >() != formatVersion))
+            {
+                throw std::runtime_error("Not a cache file or outdated.");
+            }
+
+            auto readTable = [&](Interner& interner)
+            {
+                std::vector< SymbolId > ids(in.readSize(data.size()));
+                for (auto& id : ids)
+                {
+                    id = interner.intern(in.readString());
+                }
+                return ids;
+            };
+
+            auto modules = readTable(symbols.modules);
+            auto paths = readTable(symbols.paths);
+
+            auto module = [&] { return modules.at(in.read< std::uint32_t >()); };
+            auto path = [&] { return paths.at(in.read< std::uint32_t >()); };
+
+            auto numFiles = in.readSize(data.size());
+            for (std::size_t i = 0; i < numFiles; ++i)
+            {
+                std::string relativePath(in.readString());
+                ddi::DDI ddi;
+                ddi.stamp.size = in.read< std::uint64_t >();
+                ddi.stamp.mtime = in.read< std::int64_t >();
+                ddi.stamp.hash = in.read< std::uint64_t >();
+                ddi.version = in.read< std::int32_t >();
+                ddi.revision = in.read< std::int32_t >();
+
+                ddi.rules.resize(in.readSize(data.size()));
+                for (auto& rule : ddi.rules)
+                {
+                    rule.primaryOutput = path();
+                    rule.provides.resize(in.readSize(data.size()));
+                    for (auto& provide : rule.provides)
+                    {
+                        provide.logicalName = module();
+                        provide.sourcePath = path();
+                    }
+                    rule.requires_.resize(in.readSize(data.size()));
+                    for (auto& require : rule.requires_)
+                    {
+                        require.logicalName = module();
+                    }
+                }
+
+                m_files.insert_or_assign(std::move(relativePath), std::move(ddi));
+            }
+
+            auto readLists = [&]
+            {
+                std::vector< std::vector< ModuleId > > lists(in.readSize(data.size()));
+                for (auto& list : lists)
+                {
+                    list.resize(in.readSize(data.size()));
+                    for (auto& id : list)
+                    {
+                        id = module();
+                    }
+                }
+                return lists;
+            };
+
+            if (in.read< std::uint8_t >() != 0)
+            {
+                Analysis analysis;
+                analysis.edges.resize(in.readSize(data.size()));
+                for (auto& [from, to] : analysis.edges)
+                {
+                    from = module();
+                    to = module();
+                }
+                // The IDs differ from the previous run. Restore the order to allow comparing with the current edges.
+                std::ranges::sort(analysis.edges);
+                analysis.cyclesPerSCC = in.readSize();
+                analysis.sccs = readLists();
+                analysis.cycles.resize(in.readSize(data.size()));
+                for (auto& cycles : analysis.cycles)
+                {
+                    cycles = readLists();
+                }
+
+                if (in.read< std::uint8_t >() != 0)
+                {
+                    std::vector< ModuleId > order(in.readSize(data.size()));
+                    for (auto& id : order)
+                    {
+                        id = module();
+                    }
+                    std::vector< std::uint32_t > offsets(order.size() + 1);
+                    for (auto& offset : offsets)
+                    {
+                        offset = in.read< std::uint32_t >();
+                    }
+                    std::vector< ReachabilityIndex::Range > ranges(in.readSize(data.size()));
+                    for (auto& [first, last] : ranges)
+                    {
+                        first = in.read< std::uint32_t >();
+                        last = in.read< std::uint32_t >();
+                    }
+                    analysis.reachability.emplace(std::move(order), std::move(offsets), std::move(ranges));
+                }
+                m_analysis = std::move(analysis);
+            }
+
+            if (!in.atEnd())
+            {
+                throw std::runtime_error("Unexpected data at the end of the cache.");
+            }
+        }
+    };
+} // namespace mgt
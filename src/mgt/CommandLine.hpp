@@ -0,0 +1,315 @@
+#pragma once
+
+#include "Dot.hpp"
+#include "NinjaLog.hpp"
+#include "Parallel.hpp"
+#include "Report.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    //! The options that can be set on the command line.
+    struct Options
+    {
+        //! The directory to load the DDI files from.
+        std::filesystem::path location = std::filesystem::current_path();
+
+        //! The number of threads to use.
+        unsigned jobs = defaultJobs();
+
+        //! The cache file. Defaults to "mgt.cache" in the DDI directory. Not set if caching is disabled.
+        std::optional< std::filesystem::path > cacheFile;
+
+        //! The max. number of shortest cycles to report per circular dependency.
+        std::size_t cycles = 1;
+
+        //! If true, keep running and update the results whenever DDI files change.
+        bool watch = false;
+
+        //! If true, the location is a CMake build directory. All its targets are analyzed at once.
+        bool allTargets = false;
+
+        //! If true, report the critical path of the build and how well it can be parallelized.
+        bool criticalPath = false;
+
+        //! The .ninja_log to take the compile times from for the critical path. If not set, it is searched for in
+        //! the location and its parents.
+        std::optional< std::filesystem::path > ninjaLog;
+
+        //! If true, translation units that import modules without providing one are part of the graph.
+        bool consumers = true;
+
+        //! If true, report imports that are already imported indirectly through another import.
+        bool redundantImports = false;
+
+        //! Impact queries instead of the report. Each query is a list of modules, separated by whitespace. "-" reads
+        //! one query per line from stdin.
+        std::vector< std::string > impact;
+
+        //! How much detail to put into graph.dot
+        DotOptions dot;
+
+        //! If set, write a snapshot of the graph to this file.
+        std::optional< std::filesystem::path > snapshot;
+
+        //! If set, compare these two snapshots instead of loading any DDI files.
+        std::optional< std::pair< std::filesystem::path, std::filesystem::path > > diff;
+
+        //! If true, print the time per phase, some counters and the memory usage at the end, and write them to
+        //! profile.json.
+        bool profile = false;
+
+        //! The format of the report
+        OutputFormat outputFormat = OutputFormat::text;
+
+        //! If true, print the usage and exit.
+        bool help = false;
+    };
+
+    //! The usage text. Keep in sync with @ref parseCommandLine.
+    inline constexpr std::string_view usage = R"(Usage: mgt [options] [directory]
+
+Loads all DDI files in the given directory (default: current directory) and reports missing modules and circular
+dependencies. The graph is written to graph.dot.
+
+Options:
+  -j, --jobs N      Number of threads to use. Default: number of hardware threads.
+  --cache FILE      Cache parsed DDI files and analysis results in FILE. Default: mgt.cache in the directory.
+  --no-cache        Do not use a cache.
+  --cycles N        Report up to N distinct shortest cycles per circular dependency. Default: 1.
+  --watch           Keep running and update report and graph whenever DDI files change. Linux only.
+  --all-targets DIR Analyze all targets (CMakeFiles/<target>.dir) of the CMake build directory DIR at once. Also
+                    reports circular dependencies across targets and modules provided by multiple targets.
+  --critical-path   Report the critical path of the build, the modules per level and the dependencies that shorten
+                    the critical path the most. Modules are weighted with their compile times from .ninja_log.
+  --ninja-log FILE  The .ninja_log for --critical-path. Default: .ninja_log in the directory or one of its parents.
+  --no-consumers    Leave out translation units that import modules without providing one. They are part of the
+                    critical path, the redundant imports and the impact, but not of graph.dot.
+  --redundant-imports
+                    Report imports of modules that are already imported indirectly through another import.
+  --impact MODULES  Instead of the report, list the modules and compilation units to rebuild if MODULES change.
+                    MODULES are separated by spaces. Can be given more than once. "-" reads one query per line from
+                    stdin.
+  --dot-detail LEVEL
+                    Detail of graph.dot: "full" (default), "modules" to merge partitions into their module, or a
+                    number N to merge modules by the first N dotted components of their names. Modules in circular
+                    dependencies are always shown on their own.
+  --dot-max-nodes N Reduce the detail of graph.dot until it has at most N nodes. Default: 0, no limit.
+  --snapshot FILE   Write a snapshot of the graph to FILE, to compare it with another build using --diff.
+  --diff OLD NEW    Instead of loading DDI files, compare the snapshots OLD and NEW: added and removed modules,
+                    imports and circular dependencies, new missing modules and changed numbers of imports. Exits
+                    with 1 if there are new circular dependencies or missing modules.
+  --profile         Print the time per phase, counters like the number of parsed bytes, and the memory usage at the
+                    end. Also writes them to profile.json.
+  --output-format FORMAT
+                    The format of the report: "text" (default), "json" or "sarif". JSON and SARIF print nothing but
+                    the report to stdout, the profile goes to stderr.
+  -h, --help        Print this help.
+)";
+
+    /**
+     * Parse an unsigned number argument.
+     *
+     * @throw std::runtime_error If the value is not a valid number.
+     *
+     * @param option The name of the option. Used for error messages.
+     * @param value The value to parse
+     *
+     * @return The number
+     */
+    [[nodiscard]] inline unsigned parseNumber(std::string_view option, std::string_view value)
+    {
+        unsigned result = 0;
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+        if ((error != std::errc{}) || (end != value.data() + value.size())) // NOLINT: pointer arithmetic is fine here.
+        {
+            throw std::runtime_error(std::format("Invalid value for {}: \"{}\"", option, value));
+        }
+        return result;
+    }
+
+    /**
+     * Parse the command line.
+     *
+     * @throw std::runtime_error If an option is unknown or misses its value.
+     *
+     * @param args The arguments, without the program name.
+     *
+     * @return The options
+     */
+    [[nodiscard]] inline Options parseCommandLine(std::span< const char* const > args)
+    {
+        Options options;
+        bool haveLocation = false;
+        bool noCache = false;
+
+        for (auto it = args.begin(); it != args.end(); ++it)
+        {
+            std::string_view arg = *it;
+
+            // Get the value of an option that expects one.
+            auto value = [&]() -> std::string_view
+            {
+                if (std::next(it) == args.end())
+                {
+                    throw std::runtime_error(std::format("Missing value for {}", arg));
+                }
+                return *(++it);
+            };
+
+            if ((arg == "-h") || (arg == "--help"))
+            {
+                options.help = true;
+            }
+            else if ((arg == "-j") || (arg == "--jobs"))
+            {
+                options.jobs = std::max(1U, parseNumber(arg, value()));
+            }
+            else if (arg == "--cache")
+            {
+                options.cacheFile = std::filesystem::path(value());
+            }
+            else if (arg == "--no-cache")
+            {
+                noCache = true;
+            }
+            else if (arg == "--cycles")
+            {
+                options.cycles = std::max(1U, parseNumber(arg, value()));
+            }
+            else if (arg == "--watch")
+            {
+                options.watch = true;
+            }
+            else if (arg == "--critical-path")
+            {
+                options.criticalPath = true;
+            }
+            else if (arg == "--no-consumers")
+            {
+                options.consumers = false;
+            }
+            else if (arg == "--redundant-imports")
+            {
+                options.redundantImports = true;
+            }
+            else if (arg == "--impact")
+            {
+                options.impact.emplace_back(value());
+            }
+            else if (arg == "--dot-detail")
+            {
+                auto level = value();
+                if (!parseDotDetail(level, options.dot))
+                {
+                    throw std::runtime_error(std::format("Invalid value for {}: \"{}\"", arg, level));
+                }
+            }
+            else if (arg == "--dot-max-nodes")
+            {
+                options.dot.maxNodes = parseNumber(arg, value());
+            }
+            else if (arg == "--profile")
+            {
+                options.profile = true;
+            }
+            else if (arg == "--output-format")
+            {
+                auto format = value();
+                if (!parseOutputFormat(format, options.outputFormat))
+                {
+                    throw std::runtime_error(std::format("Invalid value for {}: \"{}\"", arg, format));
+                }
+            }
+            else if (arg == "--snapshot")
+            {
+                options.snapshot = std::filesystem::path(value());
+            }
+            else if (arg == "--diff")
+            {
+                std::filesystem::path before(value());
+                options.diff.emplace(std::move(before), std::filesystem::path(value()));
+            }
+            else if (arg == "--ninja-log")
+            {
+                options.ninjaLog = std::filesystem::path(value());
+            }
+            else if (arg == "--all-targets")
+            {
+                if (haveLocation)
+                {
+                    throw std::runtime_error(std::format("{} cannot be combined with a directory", arg));
+                }
+                options.location = std::filesystem::path(value());
+                options.allTargets = true;
+                haveLocation = true;
+            }
+            else if (arg.starts_with("-"))
+            {
+                throw std::runtime_error(std::format("Unknown option: {}", arg));
+            }
+            else if (!haveLocation)
+            {
+                options.location = std::filesystem::path(arg);
+                haveLocation = true;
+            }
+            else
+            {
+                throw std::runtime_error(std::format("Unexpected argument: {}", arg));
+            }
+        }
+
+        if (options.watch && options.allTargets)
+        {
+            throw std::runtime_error("--watch cannot be combined with --all-targets");
+        }
+        if (options.watch && !options.impact.empty())
+        {
+            throw std::runtime_error("--watch cannot be combined with --impact");
+        }
+        if (options.watch && options.profile)
+        {
+            throw std::runtime_error("--watch cannot be combined with --profile");
+        }
+        if (options.diff && (options.watch || !options.impact.empty() || options.snapshot))
+        {
+            throw std::runtime_error("--diff cannot be combined with --watch, --impact or --snapshot");
+        }
+        if ((options.outputFormat != OutputFormat::text) &&
+            (options.watch || !options.impact.empty() || options.diff || options.criticalPath ||
+             options.redundantImports))
+        {
+            throw std::runtime_error("--output-format json or sarif cannot be combined with --watch, --impact, --diff, "
+                                     "--critical-path or --redundant-imports");
+        }
+
+        if (options.criticalPath && !options.ninjaLog)
+        {
+            options.ninjaLog = findNinjaLog(options.location);
+        }
+
+        if (noCache)
+        {
+            options.cacheFile.reset();
+        }
+        else if (!options.cacheFile)
+        {
+            options.cacheFile = options.location / "mgt.cache";
+        }
+
+        return options;
+    }
+} // namespace mgt
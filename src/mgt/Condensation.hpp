@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CSRGraph.hpp"
+#include "SCC.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    /**
+     * The condensation of a graph: each SCC is collapsed into a single node, which makes the graph a DAG. The nodes of
+     * the DAG are called components. A component is either an SCC or a single vertex.
+     */
+    struct Condensation
+    {
+        //! The component of each vertex
+        std::vector< std::uint32_t > componentOf;
+
+        //! The vertices of each component. The first components are the SCCs, in the order they were given.
+        std::vector< std::vector< VertexId > > components;
+
+        //! The DAG of the components. There is an edge between two components if there is an edge between any of
+        //! their vertices.
+        CSRGraph dag;
+
+        //! The components in topological order, reversed: a component comes after all components it has edges to.
+        //! For the module graph, this is the build order.
+        std::vector< std::uint32_t > order;
+
+        /**
+         * Condense a graph.
+         *
+         * @param graph The graph
+         * @param sccs The SCCs of the graph (with at least 2 vertices). Must be pair-wise disjoint.
+         *
+         * @return The condensation
+         */
+        [[nodiscard]] static Condensation make(const CSRGraph& graph, const SCCs& sccs)
+        {
+            constexpr auto none = std::numeric_limits< std::uint32_t >::max();
+            Condensation result;
+
+            // Collapse the SCCs. Every other vertex is a component of its own.
+            result.componentOf.assign(graph.numVertices(), none);
+            result.components = sccs;
+            for (std::size_t i = 0; i < sccs.size(); ++i)
+            {
+                for (auto vertex : sccs[i])
+                {
+                    result.componentOf[vertex] = static_cast< std::uint32_t >(i);
+                }
+            }
+            for (VertexId vertex = 0; vertex < graph.numVertices(); ++vertex)
+            {
+                if (result.componentOf[vertex] == none)
+                {
+                    result.componentOf[vertex] = static_cast< std::uint32_t >(result.components.size());
+                    result.components.push_back({vertex});
+                }
+            }
+
+            std::vector< GraphEdge > edges;
+            for (const auto& [from, to] : graph.edges())
+            {
+                if (result.componentOf[from] != result.componentOf[to])
+                {
+                    edges.emplace_back(result.componentOf[from], result.componentOf[to]);
+                }
+            }
+            result.dag = CSRGraph(result.components.size(), std::move(edges));
+
+            // Kahn's algorithm, starting with the components without outgoing edges.
+            auto numComponents = result.components.size();
+            result.order.reserve(numComponents);
+            std::vector< std::size_t > remaining(numComponents);
+            for (VertexId component = 0; component < numComponents; ++component)
+            {
+                remaining[component] = result.dag.outDegree(component);
+                if (remaining[component] == 0)
+                {
+                    result.order.push_back(component);
+                }
+            }
+            for (std::size_t i = 0; i < result.order.size(); ++i)
+            {
+                for (auto dependent : result.dag.predecessors(result.order[i]))
+                {
+                    if (--remaining[dependent] == 0)
+                    {
+                        result.order.push_back(dependent);
+                    }
+                }
+            }
+
+            return result;
+        }
+    };
+} // namespace mgt
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "Condensation.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace mgt
+{
+    /**
+     * The critical path and the parallelism of a build, estimated on the condensed graph of modules. See
+     * @ref Condensation.
+     *
+     * Without cycles, a module can be compiled as soon as all modules it requires are compiled. The critical path is
+     * the longest chain of such requirements, weighted by the compile time of its modules. No matter how many cores
+     * are available, the build cannot be faster than that.
+     */
+    struct CriticalPath
+    {
+        //! The components on the critical path, in build order: the first one does not require anything.
+        std::vector< std::uint32_t > path;
+
+        //! The sum of the weights on the critical path
+        double length = 0;
+
+        //! The sum of all weights
+        double totalWork = 0;
+
+        //! The number of compiled components per level. Level 0 requires nothing that is compiled, level n requires
+        //! something of level n - 1. All components of a level can be built at the same time.
+        std::vector< std::size_t > widthPerLevel;
+
+        //! A dependency between two components, and the critical path without it.
+        struct Cut
+        {
+            //! The component that requires the other one
+            std::uint32_t from = 0;
+            //! The required component
+            std::uint32_t to = 0;
+            //! The length of the critical path if this dependency did not exist
+            double length = 0;
+        };
+
+        //! The dependencies on the critical path whose removal shortens it the most. Best first.
+        std::vector< Cut > cuts;
+
+        //! The speedup over building one module after the other, with an unlimited number of cores.
+        [[nodiscard]] double parallelism() const
+        {
+            return (length > 0) ? (totalWork / length) : 0;
+        }
+    };
+
+    /**
+     * Find the critical path of a graph. See @ref CriticalPath.
+     *
+     * O(V + E) for the critical path itself. Finding the dependencies that shorten it takes one more pass over the
+     * graph per dependency on the critical path.
+     *
+     * @param condensation The condensed graph. An edge from -> to means "from requires to", hence "to" has to be
+     * built first.
+     * @param weights The weight (compile time) of each vertex
+     * @param isCompiled Whether each vertex is compiled. Modules without source are not, they do not count for the
+     * levels.
+     * @param maxCuts The max. number of dependencies to suggest for removal
+     *
+     * @return The critical path and the parallelism
+     */
+    [[nodiscard]] inline CriticalPath findCriticalPath(const Condensation& condensation,
+                                                       std::span< const double > weights,
+                                                       const std::vector< bool >& isCompiled, std::size_t maxCuts = 10)
+    {
+        constexpr auto none = std::numeric_limits< std::uint32_t >::max();
+        // The max. number of vertices + edges to visit when looking for dependencies to remove
+        constexpr std::size_t maxEffort = 200'000'000;
+        CriticalPath result;
+
+        const auto& dag = condensation.dag;
+        const auto& order = condensation.order;
+        auto numComponents = condensation.components.size();
+
+        // 1: The weight of each component
+        std::vector< double > weightOf(numComponents, 0);
+        std::vector< bool > isComponentCompiled(numComponents, false);
+        for (std::size_t vertex = 0; vertex < condensation.componentOf.size(); ++vertex)
+        {
+            weightOf[condensation.componentOf[vertex]] += weights[vertex];
+            result.totalWork += weights[vertex];
+            if (isCompiled[vertex])
+            {
+                isComponentCompiled[condensation.componentOf[vertex]] = true;
+            }
+        }
+
+        // 2: The longest path ending at each component. Ignores the dependency skipFrom -> skipTo, if given.
+        std::vector< double > finish(numComponents, 0);
+        std::vector< std::uint32_t > previous(numComponents, none);
+        auto longestPath = [&](std::uint32_t skipFrom, std::uint32_t skipTo)
+        {
+            double longest = 0;
+            for (auto component : order)
+            {
+                finish[component] = 0;
+                previous[component] = none;
+                for (auto required : dag.successors(component))
+                {
+                    if (((component != skipFrom) || (required != skipTo)) && (finish[required] > finish[component]))
+                    {
+                        finish[component] = finish[required];
+                        previous[component] = required;
+                    }
+                }
+                finish[component] += weightOf[component];
+                longest = std::max(longest, finish[component]);
+            }
+            return longest;
+        };
+
+        result.length = longestPath(none, none);
+        if (numComponents == 0)
+        {
+            return result;
+        }
+
+        auto last = static_cast< std::uint32_t >(std::ranges::max_element(finish) - finish.begin());
+        for (auto component = last; component != none; component = previous[component])
+        {
+            result.path.push_back(component);
+        }
+        std::ranges::reverse(result.path);
+
+        // 3: The levels. Like the longest path, but each compiled component counts 1 and the others nothing.
+        std::vector< std::size_t > levelOf(numComponents, 0);
+        for (auto component : order)
+        {
+            for (auto required : dag.successors(component))
+            {
+                levelOf[component] =
+                    std::max(levelOf[component], levelOf[required] + (isComponentCompiled[required] ? 1 : 0));
+            }
+            if (!isComponentCompiled[component])
+            {
+                continue;
+            }
+            if (levelOf[component] >= result.widthPerLevel.size())
+            {
+                result.widthPerLevel.resize(levelOf[component] + 1, 0);
+            }
+            result.widthPerLevel[levelOf[component]]++;
+        }
+
+        // 4: Only the dependencies on the critical path can shorten it. Try without each of them. Each try is a pass
+        // over the whole DAG. For very long critical paths, only every n-th dependency is tried to bound the effort.
+        auto effort = result.path.size() * (dag.numVertices() + dag.numEdges());
+        auto step = std::max< std::size_t >(1, effort / maxEffort);
+        for (std::size_t i = 1; i < result.path.size(); i += step)
+        {
+            auto from = result.path[i];
+            auto to = result.path[i - 1];
+            auto length = longestPath(from, to);
+            if (length < result.length)
+            {
+                result.cuts.push_back({.from = from, .to = to, .length = length});
+            }
+        }
+        std::ranges::stable_sort(result.cuts, {}, &CriticalPath::Cut::length);
+        if (result.cuts.size() > maxCuts)
+        {
+            result.cuts.resize(maxCuts);
+        }
+
+        return result;
+    }
+} // namespace mgt
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "Parallel.hpp"
+#include "Profile.hpp"
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <ranges>
+#include <vector>
+
+namespace mgt
+{
+    //! Options for @ref findShortestCycles
+    struct CycleOptions
+    {
+        //! The max. number of distinct cycles to find per SCC.
+        std::size_t maxCycles = 1;
+
+        //! The number of threads to use. SCCs are processed in parallel.
+        unsigned jobs = 1;
+    };
+
+    /**
+     * Searches short cycles within a single strongly connected component. The SCC is stored as a local graph in
+     * compressed sparse row format, with the vertices numbered in the order of the SCC. Edges leaving the SCC are not
+     * part of the local graph, so the searches never leave it.
+     *
+     * An instance keeps its buffers between searches. Use one instance per thread.
+     */
+    class CycleSearch
+    {
+    public:
+        //! A cycle in terms of local vertices. The first vertex is not repeated at the end.
+        using LocalCycle = std::vector< std::uint32_t >;
+
+        /**
+         * Set up the local graph of an SCC.
+         *
+         * @param numVertices The number of vertices of the SCC
+         * @param edges Calls the given function with each local vertex. Must return the local targets of the edges of
+         * that vertex. Targets outside the SCC must have been removed already.
+         */
+        template < typename Edges >
+        void assign(std::uint32_t numVertices, Edges&& edges)
+        {
+            m_offsets.assign(1, 0);
+            m_targets.clear();
+            for (std::uint32_t vertex = 0; vertex < numVertices; ++vertex)
+            {
+                for (auto target : edges(vertex))
+                {
+                    m_targets.push_back(target);
+                }
+                m_offsets.push_back(static_cast< std::uint32_t >(m_targets.size()));
+            }
+
+            m_parent.resize(numVertices);
+            m_queue.resize(numVertices);
+            m_visited.resize((numVertices + 63) / 64);
+        }
+
+        /**
+         * Find the shortest cycles of the local graph.
+         *
+         * A BFS from each vertex finds the shortest cycle through that vertex. The result contains the shortest of
+         * these cycles, without duplicates. For maxCycles == 1, this is exactly the shortest cycle of the SCC. For more
+         * cycles, it favours cycles through different vertices over slight variations of the same cycle.
+         *
+         * @param maxCycles The max. number of cycles to return
+         *
+         * @return The cycles, shortest first. Each cycle starts at its smallest local vertex.
+         */
+        [[nodiscard]] std::vector< LocalCycle > run(std::size_t maxCycles)
+        {
+            std::vector< LocalCycle > result;
+            auto numVertices = static_cast< std::uint32_t >(m_parent.size());
+            for (std::uint32_t start = 0; start < numVertices; ++start)
+            {
+                // Only cycles that are shorter than the longest result so far are of interest once the result is full.
+                auto limit = (result.size() < maxCycles) ? numVertices : result.back().size() - 1;
+
+                // A module importing itself, a cycle of one vertex, is as short as it gets.
+                if (limit < 1)
+                {
+                    break;
+                }
+
+                auto cycle = shortestCycleThrough(start, limit);
+                if (cycle.empty())
+                {
+                    continue;
+                }
+
+                // Distinct cycles only. Sorted by length, then by vertices to be independent of the search order.
+                auto less = [](const LocalCycle& lhs, const LocalCycle& rhs)
+                { return (lhs.size() != rhs.size()) ? (lhs.size() < rhs.size()) : (lhs < rhs); };
+                auto it = std::ranges::lower_bound(result, cycle, less);
+                if ((it != result.end()) && (*it == cycle))
+                {
+                    continue;
+                }
+                result.insert(it, std::move(cycle));
+                if (result.size() > maxCycles)
+                {
+                    result.pop_back();
+                }
+            }
+            return result;
+        }
+
+        //! The number of vertices taken from the BFS queue by all searches so far
+        [[nodiscard]] std::uint64_t numExpansions() const
+        {
+            return m_numExpansions;
+        }
+
+    private:
+        //! Marks "no vertex" in the parent buffer
+        static constexpr auto none = std::numeric_limits< std::uint32_t >::max();
+
+        //! Offsets into m_targets per vertex, plus one at the end
+        std::vector< std::uint32_t > m_offsets;
+
+        //! The targets of all edges
+        std::vector< std::uint32_t > m_targets;
+
+        //! The BFS tree. Only valid for visited vertices.
+        std::vector< std::uint32_t > m_parent;
+
+        //! The BFS queue. Every vertex gets queued at most once, so a plain array is enough.
+        std::vector< std::uint32_t > m_queue;
+
+        //! One bit per vertex. Cheap to clear for every search.
+        std::vector< std::uint64_t > m_visited;
+
+        //! See @ref numExpansions
+        std::uint64_t m_numExpansions = 0;
+
+        //! Test and set the visited bit of a vertex. Returns true if it was not visited before.
+        bool visit(std::uint32_t vertex)
+        {
+            auto& word = m_visited[vertex / 64];
+            auto bit = std::uint64_t{1} << (vertex % 64);
+            if ((word & bit) != 0)
+            {
+                return false;
+            }
+            word |= bit;
+            return true;
+        }
+
+        /**
+         * Find the shortest cycle through a vertex using BFS.
+         *
+         * @param start The vertex
+         * @param limit The max. number of edges of the cycle
+         *
+         * @return The cycle, rotated to start at its smallest vertex. Empty if there is no cycle within the limit.
+         */
+        [[nodiscard]] LocalCycle shortestCycleThrough(std::uint32_t start, std::size_t limit)
+        {
+            std::ranges::fill(m_visited, 0);
+            visit(start);
+            m_parent[start] = none;
+
+            std::size_t head = 0;
+            std::size_t tail = 0;
+            m_queue[tail++] = start;
+
+            // Level by level: all vertices of a level have the same distance to the start.
+            for (std::size_t distance = 0; (head < tail) && (distance < limit); ++distance)
+            {
+                for (auto levelEnd = tail; head < levelEnd; ++head)
+                {
+                    auto vertex = m_queue[head];
+                    m_numExpansions++;
+                    for (auto i = m_offsets[vertex]; i < m_offsets[vertex + 1]; ++i)
+                    {
+                        auto target = m_targets[i];
+                        if (target == start)
+                        {
+                            return unwind(vertex);
+                        }
+                        if (visit(target))
+                        {
+                            m_parent[target] = vertex;
+                            m_queue[tail++] = target;
+                        }
+                    }
+                }
+            }
+
+            return {};
+        }
+
+        //! Build the cycle ending at the given vertex from the BFS tree.
+        [[nodiscard]] LocalCycle unwind(std::uint32_t last) const
+        {
+            LocalCycle cycle;
+            for (auto vertex = last; vertex != none; vertex = m_parent[vertex])
+            {
+                cycle.push_back(vertex);
+            }
+            std::ranges::reverse(cycle);
+            std::ranges::rotate(cycle, std::ranges::min_element(cycle));
+            return cycle;
+        }
+    };
+
+    /**
+     * Find the shortest cycles of each strongly connected component.
+     *
+     * @tparam Vertex The vertex ID type.
+     * @tparam Neighbours Callable that returns the neighbours (the targets of the outgoing edges) of a vertex. Gets
+     * called concurrently.
+     *
+     * @param numVertices All vertex IDs must be smaller than this.
+     * @param sccs The SCCs. Must be pair-wise disjoint.
+     * @param neighbours Provides the neighbours of a vertex
+     * @param options How many cycles to find and how many threads to use.
+     *
+     * @return The cycles per SCC, in the order of the SCCs. Each cycle starts and ends with the same vertex. Shortest
+     * cycles first.
+     */
+    template < std::unsigned_integral Vertex, typename Neighbours >
+    [[nodiscard]] std::vector< std::vector< std::vector< Vertex > > > findShortestCycles(
+        std::size_t numVertices, const std::vector< std::vector< Vertex > >& sccs, Neighbours&& neighbours,
+        const CycleOptions& options)
+    {
+        // The SCC and local number of each vertex. Used to drop edges leaving an SCC.
+        constexpr auto none = std::numeric_limits< std::uint32_t >::max();
+        std::vector< std::uint32_t > sccOf(numVertices, none);
+        std::vector< std::uint32_t > localOf(numVertices, none);
+        for (std::size_t i = 0; i < sccs.size(); ++i)
+        {
+            for (std::size_t local = 0; local < sccs[i].size(); ++local)
+            {
+                sccOf[sccs[i][local]] = static_cast< std::uint32_t >(i);
+                localOf[sccs[i][local]] = static_cast< std::uint32_t >(local);
+            }
+        }
+
+        // The largest SCCs take the longest. Start with them to balance the load.
+        std::vector< std::size_t > order(sccs.size());
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::ranges::stable_sort(order, std::ranges::greater{}, [&](auto i) { return sccs[i].size(); });
+
+        std::vector< std::vector< std::vector< Vertex > > > result(sccs.size());
+        std::vector< CycleSearch > searches(std::max(1U, options.jobs));
+        parallelFor(order.size(), options.jobs,
+                    [&](std::size_t n, unsigned worker)
+                    {
+                        auto index = order[n];
+                        const auto& scc = sccs[index];
+                        auto& search = searches[worker];
+
+                        search.assign(static_cast< std::uint32_t >(scc.size()),
+                                      [&](std::uint32_t local)
+                                      {
+                                          return neighbours(scc[local]) |
+                                                 std::views::filter([&](auto target)
+                                                                    { return sccOf[target] == index; }) |
+                                                 std::views::transform([&](auto target) { return localOf[target]; });
+                                      });
+
+                        for (const auto& cycle : search.run(options.maxCycles))
+                        {
+                            auto& vertices = result[index].emplace_back();
+                            vertices.reserve(cycle.size() + 1);
+                            for (auto local : cycle)
+                            {
+                                vertices.push_back(scc[local]);
+                            }
+                            vertices.push_back(scc[cycle.front()]); // closes the loop
+                        }
+                    });
+
+        for (const auto& search : searches)
+        {
+            profile().count("cycles.bfsExpansions", search.numExpansions());
+        }
+        return result;
+    }
+} // namespace mgt
@@ -1,16 +1,27 @@
 #pragma once
 
-#ifndef NDEBUG
-    #define JSON_DIAGNOSTICS 1
-#endif
-#include <nlohmann/json.hpp>
+#include "Binary.hpp"
+#include "Discovery.hpp"
+#include "Interner.hpp"
+#include "Json.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+#include "Profile.hpp"
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <format>
-#include <fstream>
+#include <functional>
 #include <iostream>
-#include <ranges>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace mgt::ddi
 {
@@ -18,9 +29,20 @@ namespace mgt::ddi
     // Data Structure
     //
 
+    //! Identifies a specific state of a file. Used to find out whether cached data is still valid.
+    struct FileStamp
+    {
+        //! The file size in bytes
+        std::uint64_t size = 0;
+        //! The last modification time, in ticks of the file clock.
+        std::int64_t mtime = 0;
+        //! The hash of the file contents. See @ref mgt::hashBytes.
+        std::uint64_t hash = 0;
+    };
+
     /**
      * The DDI structure. Represents a compilation unit's provides/requires rules of DDI version 1 - only modules
-     * provide something.
+     * provide something. All names and paths are interned in a @ref mgt::Symbols instance.
      */
     struct DDI
     {
@@ -28,26 +50,26 @@ namespace mgt::ddi
         struct Provide
         {
             //! The logical name is the module name (also, full partition name)
-            std::string logicalName;
+            ModuleId logicalName = 0;
 
-            //! The source file where this is provided
-            std::string sourcePath = "<undefined>";
+            //! The source file where this is provided. Interned as "<undefined>" if the DDI does not specify it.
+            PathId sourcePath = 0;
         };
 
         //! A DDI require-clause
         struct Require
         {
             //! The logical name is the module name (also, full partition name)
-            std::string logicalName;
+            ModuleId logicalName = 0;
         };
 
         //! A DDI rule
         struct Rule
         {
             //! The compilation output file.
-            std::string primaryOutput;
+            PathId primaryOutput = 0;
 
-            //! A list of provided modules/partitions
+            //! A list of provided modules/partitions. Empty for consumers: translation units that only import modules.
             std::vector< Provide > provides;
             //! The list of requirements to make primaryOutput compilable
             std::vector< Require > requires_;
@@ -65,109 +87,392 @@ namespace mgt::ddi
         std::filesystem::path path;
         //! The root path where all DDI files have been loaded from.
         std::filesystem::path root;
+
+        //! The state of the file when it was loaded.
+        FileStamp stamp;
+        //! True if the rules were taken from a cache instead of parsing the file.
+        bool fromCache = false;
     };
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    // JSON Parsing Setup
+    // Parsing
     //
-    // See https://json.nlohmann.me/features/arbitrary_types/
 
-    //! @cond EXCLUDED
-
-    inline void from_json(const nlohmann::json& j, DDI::Provide& p)
+    /**
+     * A streaming reader for P1689 DDI files. This is a minimal JSON parser that only extracts what mgt needs:
+     * version, revision and per rule the primary output, the provided logical names + source paths and the required
+     * logical names. Everything else is skipped without building any intermediate representation.
+     *
+     * Strings are kept as views into the input until the rule is complete and only then get interned. Only strings that
+     * contain escape sequences need a copy.
+     */
+    class Reader : private JsonReader
     {
-        j.at("logical-name").get_to(p.logicalName);
-        if (j.count("source-path") != 0)
+    public:
+        /**
+         * Create a reader for the given JSON document.
+         *
+         * @param json The document. Must outlive the reader.
+         * @param symbols The symbol tables to intern into.
+         */
+        Reader(std::string_view json, Symbols& symbols) : JsonReader(json), m_symbols(symbols)
         {
-            j.at("source-path").get_to(p.sourcePath);
         }
-    }
 
-    inline void from_json(const nlohmann::json& j, DDI::Require& p)
-    {
-        j.at("logical-name").get_to(p.logicalName);
-    }
-
-    inline void from_json(const nlohmann::json& j, DDI::Rule& p)
-    {
-        if (j.count("provides") != 0)
+        /**
+         * Parse the document.
+         *
+         * @throw std::runtime_error On syntax errors, missing keys and unsupported DDI versions.
+         *
+         * @param ddi The DDI to fill. Only rules that provide or require modules are added.
+         */
+        void read(DDI& ddi)
         {
-            j.at("provides").get_to(p.provides);
+            std::optional< int > version;
+            std::optional< int > revision;
+            bool haveRules = false;
+
+            parseObject(
+                [&](std::string_view key)
+                {
+                    if (key == "version")
+                    {
+                        version = parseInteger();
+                    }
+                    else if (key == "revision")
+                    {
+                        revision = parseInteger();
+                    }
+                    else if (key == "rules")
+                    {
+                        haveRules = true;
+                        parseArray([&] { parseRule(ddi); });
+                    }
+                    else
+                    {
+                        skipValue();
+                    }
+                });
+
+            expectEnd();
+
+            if (!version || !revision || !haveRules)
+            {
+                throw std::runtime_error(std::format("Missing key: {}", !version    ? "version"
+                                                                        : !revision ? "revision"
+                                                                                    : "rules"));
+            }
+
+            if (*version > 1)
+            {
+                throw std::runtime_error(std::format("Expected DDI version 0 or 1. Got: {}", *version));
+            }
+
+            ddi.version = *version;
+            ddi.revision = *revision;
         }
 
-        if (j.count("requires") != 0)
+    private:
+        //! A provide clause, before interning.
+        struct RawProvide
+        {
+            std::string_view logicalName;
+            std::optional< std::string_view > sourcePath;
+        };
+
+        //! Where to intern into
+        Symbols& m_symbols;
+
+        //! Scratch space for the current rule. Re-used to avoid allocations per rule.
+        std::vector< RawProvide > m_provides;
+
+        //! Scratch space for the current rule. Re-used to avoid allocations per rule.
+        std::vector< std::string_view > m_requires;
+
+        /**
+         * Parse a rule and add it to the DDI, if it provides or requires anything.
+         *
+         * @param ddi The DDI to add to.
+         */
+        void parseRule(DDI& ddi)
         {
-            j.at("requires").get_to(p.requires_);
+            std::optional< std::string_view > primaryOutput;
+            m_provides.clear();
+            m_requires.clear();
+
+            parseObject(
+                [&](std::string_view key)
+                {
+                    if (key == "primary-output")
+                    {
+                        primaryOutput = parseString();
+                    }
+                    else if (key == "provides")
+                    {
+                        parseArray([&] { m_provides.push_back(parseProvide()); });
+                    }
+                    else if (key == "requires")
+                    {
+                        parseArray([&] { m_requires.push_back(parseLogicalName()); });
+                    }
+                    else
+                    {
+                        skipValue();
+                    }
+                });
+
+            // Rules without provides are consumers: ordinary translation units that import modules. Rules that
+            // neither provide nor require anything are of no interest. Do not bother interning them.
+            if (m_provides.empty() && m_requires.empty())
+            {
+                return;
+            }
+
+            if (!primaryOutput)
+            {
+                throw std::runtime_error("Missing key: primary-output");
+            }
+
+            auto& rule = ddi.rules.emplace_back();
+            rule.primaryOutput = m_symbols.paths.intern(*primaryOutput);
+            rule.provides.reserve(m_provides.size());
+            for (const auto& provide : m_provides)
+            {
+                rule.provides.push_back(
+                    {.logicalName = m_symbols.modules.intern(provide.logicalName),
+                     .sourcePath = m_symbols.paths.intern(provide.sourcePath.value_or("<undefined>"))});
+            }
+            rule.requires_.reserve(m_requires.size());
+            for (const auto& logicalName : m_requires)
+            {
+                rule.requires_.push_back({.logicalName = m_symbols.modules.intern(logicalName)});
+            }
         }
 
-        j.at("primary-output").get_to(p.primaryOutput);
-    }
+        //! Parse a provides entry.
+        [[nodiscard]] RawProvide parseProvide()
+        {
+            RawProvide provide;
+            bool haveName = false;
+            parseObject(
+                [&](std::string_view key)
+                {
+                    if (key == "logical-name")
+                    {
+                        provide.logicalName = parseString();
+                        haveName = true;
+                    }
+                    else if (key == "source-path")
+                    {
+                        provide.sourcePath = parseString();
+                    }
+                    else
+                    {
+                        skipValue();
+                    }
+                });
 
-    inline void from_json(const nlohmann::json& j, DDI& p)
-    {
-        j.at("rules").get_to(p.rules);
-        j.at("version").get_to(p.version);
-        j.at("revision").get_to(p.revision);
-    }
+            if (!haveName)
+            {
+                throw std::runtime_error("Missing key: logical-name");
+            }
+            return provide;
+        }
 
-    //! @endcond
+        //! Parse a requires entry and return its logical name.
+        [[nodiscard]] std::string_view parseLogicalName()
+        {
+            std::optional< std::string_view > logicalName;
+            parseObject(
+                [&](std::string_view key)
+                {
+                    if (key == "logical-name")
+                    {
+                        logicalName = parseString();
+                    }
+                    else
+                    {
+                        skipValue();
+                    }
+                });
 
+            if (!logicalName)
+            {
+                throw std::runtime_error("Missing key: logical-name");
+            }
+            return *logicalName;
+        }
+    };
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // IO
     //
 
+    //! The outcome of loading a single DDI file: the DDI or an error message.
+    using FileResult = std::variant< DDI, std::string >;
+
+    /**
+     * Looks up previously loaded DDI. Gets the path of the DDI file, relative to the root, and its current stamp. If
+     * the hash of the stamp is 0, it is not known yet. Returns nullptr if there is no matching DDI. Must be
+     * thread-safe.
+     */
+    using CacheLookup =
+        std::function< const DDI*(const std::filesystem::path& relativePath, const FileStamp& stamp) >;
+
+    //! How the DDI files were found and how long each phase of @ref load took.
+    struct LoadTimes
+    {
+        //! Where the list of DDI files came from
+        DiscoverySource source = DiscoverySource::walk;
+        //! The time it took to find the DDI files
+        std::chrono::duration< double, std::milli > discovery{};
+        //! The time it took to read and parse the DDI files, or to take them from the cache.
+        std::chrono::duration< double, std::milli > parsing{};
+    };
+
+    //! The result of @ref load
+    struct LoadResult
+    {
+        //! All successfully loaded DDI, sorted by path.
+        std::vector< DDI > ddis;
+
+        //! Number of DDI files that were taken from the cache
+        std::size_t cacheHits = 0;
+        //! Number of DDI files that had to be parsed
+        std::size_t cacheMisses = 0;
+
+        //! The discovery source and the time per phase
+        LoadTimes times;
+    };
+
+    /**
+     * Load a single DDI file.
+     *
+     * If a cache lookup is given, it is asked first with size and modification time of the file. If that does not
+     * match, the file contents are hashed and the lookup is asked again. Only if that fails too, the file gets parsed.
+     *
+     * @param path The DDI file
+     * @param root The root directory the file was found in. Used for error reporting.
+     * @param symbols The symbol tables to intern all module names and paths into.
+     * @param lookup Optional. A cache of previously loaded DDI.
+     *
+     * @return The DDI or an error message
+     */
+    [[nodiscard]] inline FileResult loadFile(const std::filesystem::path& path, const std::filesystem::path& root,
+                                             Symbols& symbols, const CacheLookup& lookup = {})
+    {
+        try
+        {
+            FileStamp stamp;
+            std::filesystem::path relativePath;
+            if (lookup)
+            {
+                relativePath = path.lexically_relative(root);
+                stamp.size = std::filesystem::file_size(path);
+                stamp.mtime = std::filesystem::last_write_time(path).time_since_epoch().count();
+            }
+
+            // Re-use cached rules. The path and stamp of the cached DDI are refreshed. The content is the same, so is
+            // the hash - which might not have been calculated yet.
+            auto fromCache = [&](const DDI& cached)
+            {
+                auto ddi = cached;
+                ddi.path = path;
+                ddi.root = root;
+                ddi.stamp = {.size = stamp.size, .mtime = stamp.mtime, .hash = cached.stamp.hash};
+                ddi.fromCache = true;
+                return ddi;
+            };
+
+            if (const auto* cached = lookup ? lookup(relativePath, stamp) : nullptr)
+            {
+                return fromCache(*cached);
+            }
+
+            const MappedFile file(path);
+            if (lookup)
+            {
+                // Touched, but not changed?
+                stamp.hash = hashBytes(file.view());
+                if (const auto* cached = lookup(relativePath, stamp))
+                {
+                    return fromCache(*cached);
+                }
+            }
+
+            DDI ddi;
+            Reader(file.view(), symbols).read(ddi);
+            profile().count("bytes.parsed", file.view().size());
+            ddi.path = path;
+            ddi.root = root;
+            ddi.stamp = stamp;
+
+            return ddi;
+        }
+        catch (std::exception& e)
+        {
+            auto relativePath = std::filesystem::relative(path, root);
+            return std::format("ERR: Failed to load DDI file ({}). Error: {}", std::string(relativePath), e.what());
+        }
+    }
+
     /**
      * Find and load all DDI files in a given directory.
      *
+     * The files are found with @ref discover first. Then a pool of workers reads and parses them. Each result is
+     * stored at the index of its file. Hence, the result and the reported errors are the same, regardless of the
+     * number of jobs.
+     *
+     * @throw std::filesystem::filesystem_error If the directory cannot be read.
+     *
      * @param root The root directory to search in.
+     * @param symbols The symbol tables to intern all module names and paths into.
+     * @param jobs The number of worker threads. With 1, everything happens on the calling thread.
+     * @param lookup Optional. A cache of previously loaded DDI. See @ref loadFile.
      *
-     * @return a range of @ref mgt::DDI instances
+     * @return All loaded DDI (including those without module exports), the cache statistics and the timing.
      */
-    [[nodiscard]] inline decltype(auto) load(const std::filesystem::path& root)
+    [[nodiscard]] inline LoadResult load(const std::filesystem::path& root, Symbols& symbols, unsigned jobs = 1,
+                                         const CacheLookup& lookup = {})
     {
-        return
-            // 1: Find all ddi files
-            std::filesystem::recursive_directory_iterator(root) |
-            std::views::filter([](auto&& x) { return x.path().extension() == ".ddi"; }) |
-            // 2: Load them into the mgt::DDI struct
-            std::views::transform(
-                [=](auto&& x) -> std::optional< DDI > // std::expected not yet available
-                {
-                    try
-                    {
-                        auto ddiJson = nlohmann::json::parse(std::ifstream(x.path()));
-                        if (ddiJson["version"].get< int >() > 1)
-                        {
-                            throw std::runtime_error(
-                                std::format("Expected DDI version 0 or 1. Got: {}", ddiJson["version"].get< int >()));
-                        }
-
-                        auto ddi = ddiJson.get< DDI >();
-                        ddi.path = x.path();
-                        ddi.root = root;
-
-                        // Remove all rules that have no "provides"? If we keep those, we would include sinks that
-                        // consume modules. That's not (yet) supported.
-                        ddi.rules = ddi.rules | std::views::filter([](auto&& rule) { return !rule.provides.empty(); }) |
-                                    std::ranges::to< std::vector >();
-
-                        return ddi;
-                    }
-                    catch (std::exception& e)
-                    {
-                        auto relativePath = std::filesystem::relative(x, root);
-                        std::cerr << std::format("ERR: Failed to load DDI file ({}). Error: {}",
-                                                 std::string(relativePath), e.what())
-                                  << "\n";
-                    }
+        LoadResult result;
+
+        // 1: Find all ddi files
+        auto start = std::chrono::steady_clock::now();
+        auto discovered = [&]
+        {
+            const ScopedTimer timer("discovery");
+            return discover(root, jobs);
+        }();
+        auto discoveredAt = std::chrono::steady_clock::now();
+        result.times.source = discovered.source;
+        profile().count("files.discovered", discovered.files.size());
+
+        // 2: Load them into the mgt::DDI struct
+        std::vector< std::optional< FileResult > > loaded(discovered.files.size());
+        {
+            const ScopedTimer timer("parsing");
+            parallelFor(discovered.files.size(), jobs, [&](std::size_t i, unsigned)
+                        { loaded[i] = loadFile(discovered.files[i], root, symbols, lookup); });
+        }
+
+        // 3: Report errors
+        for (auto& file : loaded)
+        {
+            if (const auto* error = std::get_if< std::string >(&*file))
+            {
+                std::cerr << *error << "\n";
+                continue;
+            }
+
+            auto& ddi = std::get< DDI >(*file);
+            (ddi.fromCache ? result.cacheHits : result.cacheMisses)++;
+            result.ddis.push_back(std::move(ddi));
+        }
 
-                    return std::nullopt;
-                }) |
-            // 3: "cache" the results in a vector. Refer to the C++ ranges transform+filter issue. Transform would be
-            // called twice.
-            std::ranges::to< std::vector >() |
-            // 4: Remove trash (no module exports)
-            std::views::filter([](auto&& x) { return x.has_value() && !x.value().rules.empty(); }) |
-            std::views::transform([](auto&& x) { return x.value(); });
+        profile().count("files.parsed", result.cacheMisses);
+        profile().count("files.cached", result.cacheHits);
+        result.times.discovery = discoveredAt - start;
+        result.times.parsing = std::chrono::steady_clock::now() - discoveredAt;
+        return result;
     }
 } // namespace mgt::ddi
@@ -0,0 +1,498 @@
+#pragma once
+
+#include "Json.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <set>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace mgt::ddi
+{
+    //! Where the list of DDI files came from. See @ref discover.
+    enum class DiscoverySource
+    {
+        //! The CXXDependInfo.json files CMake writes per target
+        cmake,
+        //! The outputs of the scan rules in build.ninja
+        ninja,
+        //! A walk over the directory tree
+        walk
+    };
+
+    //! A human readable name of a discovery source
+    [[nodiscard]] inline std::string_view toString(DiscoverySource source)
+    {
+        switch (source)
+        {
+            case DiscoverySource::cmake:
+                return "CMake target info";
+            case DiscoverySource::ninja:
+                return "Ninja manifest";
+            case DiscoverySource::walk:
+                break;
+        }
+        return "directory walk";
+    }
+
+    //! The result of @ref discover
+    struct Discovery
+    {
+        //! The DDI files, sorted. All paths start with the root directory that was searched.
+        std::vector< std::filesystem::path > files;
+
+        //! Where the list of files came from
+        DiscoverySource source = DiscoverySource::walk;
+    };
+
+    namespace detail
+    {
+        /**
+         * Express a path relative to a root directory, spelled like the root was given. The build system records use
+         * absolute paths, the directory walk uses paths starting with the root. They have to match to compare paths,
+         * e.g. for the cache.
+         *
+         * @param root The root directory as given by the user
+         * @param absoluteRoot The absolute, normalized root
+         * @param path An absolute path, or a path relative to the absolute root.
+         *
+         * @return The path starting with root. std::nullopt if the path is not within root.
+         */
+        [[nodiscard]] inline std::optional< std::filesystem::path > relocate(const std::filesystem::path& root,
+                                                                            const std::filesystem::path& absoluteRoot,
+                                                                            const std::filesystem::path& path)
+        {
+            auto relative = (absoluteRoot / path).lexically_normal().lexically_relative(absoluteRoot);
+            if (relative.empty() || (*relative.begin() == ".."))
+            {
+                return std::nullopt;
+            }
+            return (relative == ".") ? root : (root / relative);
+        }
+
+        /**
+         * Reads the object files from the CXXDependInfo.json file CMake writes into each target directory that uses
+         * modules. CMake scans each of these object files into a DDI file named after the object file plus ".ddi".
+         */
+        class DependInfoReader : private JsonReader
+        {
+        public:
+            //! Create a reader for the given JSON document. It must outlive the reader.
+            explicit DependInfoReader(std::string_view json) : JsonReader(json)
+            {
+            }
+
+            /**
+             * Parse the document.
+             *
+             * @throw std::runtime_error On syntax errors.
+             *
+             * @return The top-level build directory (if given) and the object files, as written by CMake. Object files
+             * are relative to the top-level build directory.
+             */
+            [[nodiscard]] std::pair< std::string, std::vector< std::string > > read()
+            {
+                std::string topBuildDir;
+                std::vector< std::string > objects;
+                parseObject(
+                    [&](std::string_view key)
+                    {
+                        if (key == "dir-top-bld")
+                        {
+                            topBuildDir = parseString();
+                        }
+                        else if ((key == "cxx-modules") || (key == "sources"))
+                        {
+                            // Both map object files to their details.
+                            parseObject(
+                                [&](std::string_view object)
+                                {
+                                    objects.emplace_back(object);
+                                    skipValue();
+                                });
+                        }
+                        else
+                        {
+                            skipValue();
+                        }
+                    });
+                expectEnd();
+
+                return {std::move(topBuildDir), std::move(objects)};
+            }
+        };
+
+        /**
+         * Collect the outputs of all build statements of a Ninja manifest and of the manifests it includes.
+         *
+         * @param file The manifest
+         * @param buildDir The directory Ninja runs in. Relative paths are relative to it.
+         * @param visited The manifests that have been read already. Protects against include loops.
+         * @param outputs Receives the outputs
+         */
+        inline void collectNinjaOutputs(const std::filesystem::path& file, const std::filesystem::path& buildDir,
+                                        std::set< std::filesystem::path >& visited,
+                                        std::vector< std::filesystem::path >& outputs)
+        {
+            if (!visited.insert(file.lexically_normal()).second)
+            {
+                return;
+            }
+
+            const MappedFile mapped(file);
+            auto text = mapped.view();
+
+            // Split a statement into its paths. Handles the escapes of Ninja paths: "$ ", "$:", "$$" and "$\n".
+            // Stops at an unescaped ':'. Paths with variables are dropped, their value is not known here.
+            auto parsePaths = [](std::string_view statement)
+            {
+                std::vector< std::string > paths;
+                std::string current;
+                bool hasVariable = false;
+                auto flush = [&]
+                {
+                    if (!current.empty() && !hasVariable && (current != "|") && (current != "||"))
+                    {
+                        paths.push_back(std::move(current));
+                    }
+                    current.clear();
+                    hasVariable = false;
+                };
+
+                for (std::size_t i = 0; i < statement.size(); ++i)
+                {
+                    auto c = statement[i];
+                    if ((c == '$') && (i + 1 < statement.size()))
+                    {
+                        auto escaped = statement[++i];
+                        if ((escaped == ' ') || (escaped == ':') || (escaped == '$'))
+                        {
+                            current.push_back(escaped);
+                        }
+                        else if (escaped == '\n')
+                        {
+                            flush();
+                        }
+                        else
+                        {
+                            hasVariable = true;
+                        }
+                    }
+                    else if ((c == ' ') || (c == '\n') || (c == '\r'))
+                    {
+                        flush();
+                    }
+                    else if (c == ':')
+                    {
+                        break;
+                    }
+                    else
+                    {
+                        current.push_back(c);
+                    }
+                }
+                flush();
+                return paths;
+            };
+
+            // Iterate over the statements. A line ending with '$' continues on the next line.
+            std::size_t pos = 0;
+            while (pos < text.size())
+            {
+                auto end = pos;
+                while ((end < text.size()) && (text[end] != '\n'))
+                {
+                    // Skip escaped characters, including escaped line breaks.
+                    end += (text[end] == '$') ? 2U : 1U;
+                }
+                end = std::min(end, text.size());
+                auto statement = text.substr(pos, end - pos);
+                pos = end + 1;
+
+                if (statement.starts_with("build "))
+                {
+                    for (auto& output : parsePaths(statement.substr(6)))
+                    {
+                        outputs.emplace_back(std::move(output));
+                    }
+                }
+                else if (statement.starts_with("include ") || statement.starts_with("subninja "))
+                {
+                    auto paths = parsePaths(statement.substr(statement.find(' ') + 1));
+                    if (!paths.empty())
+                    {
+                        collectNinjaOutputs(buildDir / paths.front(), buildDir, visited, outputs);
+                    }
+                }
+            }
+        }
+
+        //! True if a directory cannot contain DDI files and is not worth walking.
+        [[nodiscard]] inline bool isPruned(const std::filesystem::path& directory)
+        {
+            // Hidden directories: .git, .cmake (file API), ...
+            auto name = directory.filename().native();
+            if (name.starts_with('.'))
+            {
+                return true;
+            }
+
+            // In a CMakeFiles directory, only the target directories contain DDI. Skip the compiler checks, scratch
+            // directories and the like.
+            return (directory.parent_path().filename() == "CMakeFiles") && (directory.extension() != ".dir");
+        }
+
+        /**
+         * Find all DDI files below a directory. Directories are read in parallel. Directories that cannot contain DDI
+         * files are skipped, see @ref isPruned.
+         *
+         * @param root The directory to walk
+         * @param jobs The number of threads to use
+         *
+         * @return The DDI files, sorted
+         */
+        [[nodiscard]] inline std::vector< std::filesystem::path > walk(const std::filesystem::path& root,
+                                                                       unsigned jobs)
+        {
+            jobs = std::max(1U, jobs);
+            std::vector< std::vector< std::filesystem::path > > found(jobs);
+
+            // The directories still to be read. The walk is done once no directory is pending anymore.
+            WorkQueue< std::filesystem::path > queue;
+            std::atomic< std::size_t > pending = 1;
+            queue.push(root);
+
+            parallelFor(jobs, jobs,
+                        [&](std::size_t, unsigned worker)
+                        {
+                            while (auto directory = queue.pop())
+                            {
+                                // Directories that cannot be read are skipped with a warning, those that vanished
+                                // in the mean time silently. Symlinks are not followed.
+                                std::error_code error;
+                                for (std::filesystem::directory_iterator it(*directory, error), end;
+                                     !error && (it != end); it.increment(error))
+                                {
+                                    const auto& path = it->path();
+                                    std::error_code statusError;
+                                    if (it->is_directory(statusError) && !it->is_symlink(statusError))
+                                    {
+                                        if (!isPruned(path))
+                                        {
+                                            ++pending;
+                                            queue.push(path);
+                                        }
+                                    }
+                                    else if (path.extension() == ".ddi")
+                                    {
+                                        found[worker].push_back(path);
+                                    }
+                                }
+                                if (error && (error != std::errc::no_such_file_or_directory))
+                                {
+                                    // One write per line, the workers share stderr.
+                                    std::cerr << std::format("W: Skipped the directory {}, its DDI files are missing "
+                                                             "from the graph. Error: {}\n",
+                                                             directory->string(), error.message());
+                                }
+
+                                if (--pending == 0)
+                                {
+                                    queue.close();
+                                }
+                            }
+                        });
+
+            std::vector< std::filesystem::path > result;
+            for (auto& files : found)
+            {
+                std::ranges::move(files, std::back_inserter(result));
+            }
+            // Comparing the strings is a lot cheaper than comparing paths element by element.
+            std::ranges::sort(result, {}, &std::filesystem::path::native);
+            return result;
+        }
+
+        //! Keep the files that exist, sorted and without duplicates.
+        [[nodiscard]] inline std::vector< std::filesystem::path > existing(std::vector< std::filesystem::path > files)
+        {
+            std::ranges::sort(files, {}, &std::filesystem::path::native);
+            auto [first, last] = std::ranges::unique(files);
+            files.erase(first, last);
+            std::erase_if(files,
+                          [](const auto& file)
+                          {
+                              std::error_code error;
+                              return !std::filesystem::is_regular_file(file, error);
+                          });
+            return files;
+        }
+    } // namespace detail
+
+    /**
+     * Read the list of target directories CMake keeps in CMakeFiles/TargetDirectories.txt.
+     *
+     * @param buildDir The top-level CMake build directory
+     *
+     * @return The existing target directories within buildDir, sorted. std::nullopt if there is no such list.
+     */
+    [[nodiscard]] inline std::optional< std::vector< std::filesystem::path > > targetDirectories(
+        const std::filesystem::path& buildDir)
+    {
+        auto list = buildDir / "CMakeFiles" / "TargetDirectories.txt";
+        if (!std::filesystem::is_regular_file(list))
+        {
+            return std::nullopt;
+        }
+
+        auto absoluteRoot = std::filesystem::weakly_canonical(buildDir);
+        std::vector< std::filesystem::path > result;
+        const MappedFile mapped(list);
+        for (auto line : mapped.view() | std::views::split('\n'))
+        {
+            auto path = std::string_view(line);
+            if (path.ends_with('\r'))
+            {
+                path.remove_suffix(1);
+            }
+            if (auto directory = path.empty() ? std::nullopt : detail::relocate(buildDir, absoluteRoot, path))
+            {
+                std::error_code error;
+                if (std::filesystem::is_directory(*directory, error))
+                {
+                    result.push_back(std::move(*directory));
+                }
+            }
+        }
+
+        std::ranges::sort(result);
+        return result;
+    }
+
+    /**
+     * Find the DDI files in a directory. Walking a whole build directory is slow, as it contains lots of object files,
+     * BMIs and other artifacts. So the records of the build system are asked first:
+     *
+     * 1. CMake: The CXXDependInfo.json files of the targets list the object files that get scanned. If the directory
+     *    is a target directory, its own file is used. If it is a build directory, the target directories are taken
+     *    from CMakeFiles/TargetDirectories.txt.
+     * 2. Ninja: The outputs of the build statements in build.ninja (and the files it includes) that end with ".ddi".
+     * 3. A parallel walk over the directory tree, skipping directories that cannot contain DDI files.
+     *
+     * Only files that exist are returned. If a record does not lead to any existing DDI file, the next one is tried.
+     *
+     * @throw std::filesystem::filesystem_error If the directory cannot be read.
+     *
+     * @param root The directory to search in
+     * @param jobs The number of threads to use
+     *
+     * @return The DDI files and where they have been found.
+     */
+    [[nodiscard]] inline Discovery discover(const std::filesystem::path& root, unsigned jobs = 1)
+    {
+        if (!std::filesystem::is_directory(root))
+        {
+            throw std::filesystem::filesystem_error("Cannot search for DDI files", root,
+                                                    std::make_error_code(std::errc::not_a_directory));
+        }
+
+        auto absoluteRoot = std::filesystem::weakly_canonical(root);
+
+        // 1: CMake
+        std::vector< std::filesystem::path > targets;
+        if (std::filesystem::exists(root / "CXXDependInfo.json"))
+        {
+            targets.push_back(root);
+        }
+        else if (auto directories = targetDirectories(root))
+        {
+            targets = std::move(*directories);
+        }
+
+        std::vector< std::filesystem::path > files;
+        for (const auto& target : targets)
+        {
+            auto info = target / "CXXDependInfo.json";
+            std::error_code error;
+            if (!std::filesystem::is_regular_file(info, error))
+            {
+                continue;
+            }
+
+            try
+            {
+                const MappedFile mapped(info);
+                auto [topBuildDir, objects] = detail::DependInfoReader(mapped.view()).read();
+                auto base = topBuildDir.empty() ? absoluteRoot : std::filesystem::path(topBuildDir);
+                for (const auto& object : objects)
+                {
+                    if (auto file = detail::relocate(root, absoluteRoot, base / (object + ".ddi")))
+                    {
+                        files.push_back(std::move(*file));
+                    }
+                }
+            }
+            catch (std::exception&)
+            {
+                // Not the format we expect. Let the other ways of discovery do their job.
+                files.clear();
+                break;
+            }
+        }
+
+        files = detail::existing(std::move(files));
+        if (!files.empty())
+        {
+            return {.files = std::move(files), .source = DiscoverySource::cmake};
+        }
+
+        // 2: Ninja
+        if (std::filesystem::exists(root / "build.ninja"))
+        {
+            try
+            {
+                std::set< std::filesystem::path > visited;
+                std::vector< std::filesystem::path > outputs;
+                detail::collectNinjaOutputs(root / "build.ninja", root, visited, outputs);
+                for (const auto& output : outputs)
+                {
+                    if (output.extension() != ".ddi")
+                    {
+                        continue;
+                    }
+                    if (auto file = detail::relocate(root, absoluteRoot, output))
+                    {
+                        files.push_back(std::move(*file));
+                    }
+                }
+            }
+            catch (std::exception&)
+            {
+                files.clear();
+            }
+
+            files = detail::existing(std::move(files));
+            if (!files.empty())
+            {
+                return {.files = std::move(files), .source = DiscoverySource::ninja};
+            }
+        }
+
+        // 3: Walk
+        return {.files = detail::walk(root, jobs), .source = DiscoverySource::walk};
+    }
+} // namespace mgt::ddi
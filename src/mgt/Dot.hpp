@@ -0,0 +1,340 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    //! How much detail to put into a DOT file. The default is every module as a node of its own.
+    struct DotOptions
+    {
+        //! Merge partitions into their primary module: nx.fmt:Format becomes part of nx.fmt.
+        bool mergePartitions = false;
+
+        //! If not 0, merge modules by the first N dotted components of their name. For 2, nx.fmt.formatter becomes
+        //! part of nx.fmt.*. Implies mergePartitions.
+        std::size_t prefixDepth = 0;
+
+        //! If not 0, remove detail until there are at most this many nodes, or no more detail can be removed.
+        std::size_t maxNodes = 0;
+
+        bool operator==(const DotOptions&) const = default;
+    };
+
+    /**
+     * Parse a detail level: "full", "modules" (partitions merged) or a number N (merged by the first N dotted
+     * components of the module names).
+     *
+     * @param level The level
+     * @param options The options to set the level in
+     *
+     * @return False if the level is invalid.
+     */
+    [[nodiscard]] inline bool parseDotDetail(std::string_view level, DotOptions& options)
+    {
+        if (level == "full")
+        {
+            options.mergePartitions = false;
+            options.prefixDepth = 0;
+            return true;
+        }
+        if (level == "modules")
+        {
+            options.mergePartitions = true;
+            options.prefixDepth = 0;
+            return true;
+        }
+
+        std::size_t depth = 0;
+        auto [end, error] = std::from_chars(level.data(), level.data() + level.size(), depth);
+        if ((error != std::errc{}) || (end != level.data() + level.size()) || (depth == 0)) // NOLINT: pointers.
+        {
+            return false;
+        }
+        options.mergePartitions = true;
+        options.prefixDepth = depth;
+        return true;
+    }
+
+    //! Describes the detail level, e.g. for the label of a graph.
+    [[nodiscard]] inline std::string toString(const DotOptions& options)
+    {
+        if (options.prefixDepth != 0)
+        {
+            return std::format("modules merged by the first {} name component(s)", options.prefixDepth);
+        }
+        return options.mergePartitions ? "partitions merged into their modules" : "all modules";
+    }
+
+    //! Nodes of a DOT file that stand for one or more vertices. See @ref groupNodes.
+    struct NodeGroups
+    {
+        //! A node
+        struct Group
+        {
+            //! The name to show
+            std::string label;
+            //! The vertices that are part of this node
+            std::vector< std::uint32_t > members;
+        };
+
+        //! The node of each vertex
+        std::vector< std::uint32_t > groupOf;
+
+        //! The nodes
+        std::vector< Group > groups;
+
+        //! The detail that was used. Less than requested, if there were too many nodes.
+        DotOptions detail;
+    };
+
+    namespace detail
+    {
+        //! The module name without partition: nx.fmt for nx.fmt:Format
+        [[nodiscard]] inline std::string_view primaryModule(std::string_view name)
+        {
+            return name.substr(0, name.find(':'));
+        }
+
+        //! The number of dotted components of a name
+        [[nodiscard]] inline std::size_t numComponents(std::string_view name)
+        {
+            return static_cast< std::size_t >(std::ranges::count(name, '.')) + 1;
+        }
+
+        //! The first depth dotted components of a name, or the whole name
+        [[nodiscard]] inline std::string_view prefix(std::string_view name, std::size_t depth)
+        {
+            std::size_t end = 0;
+            for (std::size_t i = 0; i < depth; ++i)
+            {
+                end = name.find('.', end + ((i == 0) ? 0 : 1));
+                if (end == std::string_view::npos)
+                {
+                    return name;
+                }
+            }
+            return name.substr(0, end);
+        }
+
+        /**
+         * Group the vertices for one detail level.
+         *
+         * @param names The name of each vertex
+         * @param pinned Vertices that always get a node of their own
+         * @param detail The detail level. maxNodes is ignored.
+         */
+        [[nodiscard]] inline NodeGroups group(std::span< const std::string_view > names,
+                                              const std::vector< bool >& pinned, const DotOptions& detail)
+        {
+            NodeGroups result;
+            result.detail = detail;
+            result.groupOf.resize(names.size());
+
+            std::unordered_map< std::string_view, std::uint32_t > groupOfKey;
+            for (std::size_t vertex = 0; vertex < names.size(); ++vertex)
+            {
+                auto name = names[vertex];
+                auto group = static_cast< std::uint32_t >(result.groups.size());
+                if (pinned[vertex])
+                {
+                    result.groups.push_back({.label = std::string(name), .members = {}});
+                }
+                else
+                {
+                    auto key = name;
+                    if (detail.mergePartitions || (detail.prefixDepth != 0))
+                    {
+                        key = primaryModule(key);
+                    }
+                    if (detail.prefixDepth != 0)
+                    {
+                        key = prefix(key, detail.prefixDepth);
+                    }
+
+                    auto [it, inserted] = groupOfKey.try_emplace(key, group);
+                    group = it->second;
+                    if (inserted)
+                    {
+                        result.groups.push_back({.label = std::string(key), .members = {}});
+                    }
+                }
+
+                result.groupOf[vertex] = group;
+                result.groups[group].members.push_back(static_cast< std::uint32_t >(vertex));
+            }
+
+            // Prefix groups with other modules than the one named like the prefix are shown as such.
+            if (detail.prefixDepth != 0)
+            {
+                for (auto& group : result.groups)
+                {
+                    auto isPrefixGroup = std::ranges::any_of(group.members,
+                                                             [&](auto vertex)
+                                                             {
+                                                                 return !pinned[vertex] &&
+                                                                        (primaryModule(names[vertex]) != group.label);
+                                                             });
+                    if (isPrefixGroup)
+                    {
+                        group.label += ".*";
+                    }
+                }
+            }
+
+            return result;
+        }
+    } // namespace detail
+
+    /**
+     * Decide which vertices share a node in a DOT file. Vertices are merged by their module names, depending on the
+     * requested detail. If there are more nodes than allowed, the detail is reduced step by step: partitions are
+     * merged, then modules are merged by fewer and fewer dotted name components.
+     *
+     * @param names The module name of each vertex
+     * @param pinned Vertices that always get a node of their own, like those in an SCC.
+     * @param options The requested detail
+     *
+     * @return The nodes
+     */
+    [[nodiscard]] inline NodeGroups groupNodes(std::span< const std::string_view > names,
+                                               const std::vector< bool >& pinned, const DotOptions& options)
+    {
+        auto result = detail::group(names, pinned, options);
+        if ((options.maxNodes == 0) || (result.groups.size() <= options.maxNodes))
+        {
+            return result;
+        }
+
+        std::size_t maxDepth = 0;
+        for (auto name : names)
+        {
+            maxDepth = std::max(maxDepth, detail::numComponents(detail::primaryModule(name)));
+        }
+
+        // Coarser and coarser, starting at the requested detail.
+        std::vector< DotOptions > levels;
+        if (!options.mergePartitions && (options.prefixDepth == 0))
+        {
+            levels.push_back({.mergePartitions = true, .prefixDepth = 0, .maxNodes = options.maxNodes});
+        }
+        auto firstDepth = (options.prefixDepth != 0) ? options.prefixDepth - 1 : maxDepth - 1;
+        for (auto depth = firstDepth; depth >= 1; --depth)
+        {
+            levels.push_back({.mergePartitions = true, .prefixDepth = depth, .maxNodes = options.maxNodes});
+        }
+
+        for (const auto& level : levels)
+        {
+            result = detail::group(names, pinned, level);
+            if (result.groups.size() <= options.maxNodes)
+            {
+                break;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Writes formatted text to a file through a buffer. Avoids a temporary string and a stream operation per line.
+     */
+    class BufferedWriter
+    {
+    public:
+        /**
+         * Open the file.
+         *
+         * @throw std::runtime_error If the file cannot be opened.
+         *
+         * @param file The file to write to. Gets truncated.
+         * @param capacity Write to the file whenever the buffer gets this large.
+         */
+        explicit BufferedWriter(const std::filesystem::path& file, std::size_t capacity = std::size_t{1} << 16U)
+            : m_out(file, std::ios::binary | std::ios::trunc), m_file(file), m_capacity(capacity)
+        {
+            if (!m_out)
+            {
+                throw std::runtime_error(std::format("Cannot write {}", file.string()));
+            }
+            m_buffer.reserve(capacity + 1024);
+        }
+
+        BufferedWriter(const BufferedWriter&) = delete;
+        BufferedWriter& operator=(const BufferedWriter&) = delete;
+        BufferedWriter(BufferedWriter&&) = delete;
+        BufferedWriter& operator=(BufferedWriter&&) = delete;
+
+        //! Writes what is left. Errors are ignored, call @ref close to see them.
+        ~BufferedWriter()
+        {
+            try
+            {
+                flush();
+            }
+            catch (...) // NOLINT: nothing to be done about it in a destructor.
+            {
+            }
+        }
+
+        /**
+         * Append formatted text.
+         *
+         * @param format The format string
+         * @param args The arguments
+         */
+        template < typename... Args >
+        void print(std::format_string< Args... > format, Args&&... args)
+        {
+            std::format_to(std::back_inserter(m_buffer), format, std::forward< Args >(args)...);
+            if (m_buffer.size() >= m_capacity)
+            {
+                flush();
+            }
+        }
+
+        /**
+         * Write everything to the file.
+         *
+         * @throw std::runtime_error If writing fails.
+         */
+        void close()
+        {
+            flush();
+            m_out.close();
+            if (!m_out)
+            {
+                throw std::runtime_error(std::format("Cannot write {}", m_file.string()));
+            }
+        }
+
+    private:
+        std::ofstream m_out;
+        std::filesystem::path m_file;
+        std::size_t m_capacity;
+        std::string m_buffer;
+
+        void flush()
+        {
+            m_out.write(m_buffer.data(), static_cast< std::streamsize >(m_buffer.size()));
+            m_buffer.clear();
+            if (!m_out)
+            {
+                throw std::runtime_error(std::format("Cannot write {}", m_file.string()));
+            }
+        }
+    };
+} // namespace mgt
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    //! A compact handle to an interned string. IDs are dense and start at 0.
+    using SymbolId = std::uint32_t;
+
+    //! The ID of an interned logical module name.
+    using ModuleId = SymbolId;
+
+    //! The ID of an interned file path (source files, compilation outputs).
+    using PathId = SymbolId;
+
+    /**
+     * A simple bump allocator for strings. Memory is allocated in large blocks and never moved or freed individually.
+     * Views handed out by @ref store stay valid as long as the arena lives, even if the arena itself is moved.
+     */
+    class StringArena
+    {
+    public:
+        /**
+         * Copy the given string into the arena.
+         *
+         * @param str The string to copy
+         *
+         * @return A view to the copy. Stable for the lifetime of the arena.
+         */
+        [[nodiscard]] std::string_view store(std::string_view str)
+        {
+            if (str.size() > m_remaining)
+            {
+                // Oversized strings get their own block. This wastes the rest of the current block, but that only
+                // happens for absurdly long module names or paths.
+                auto size = std::max(blockSize, str.size());
+                m_blocks.emplace_back(std::make_unique_for_overwrite< char[] >(size));
+                m_head = m_blocks.back().get();
+                m_remaining = size;
+            }
+
+            auto* copy = m_head;
+            std::ranges::copy(str, copy);
+            m_head += str.size(); // NOLINT: pointer arithmetic is the point of a bump allocator.
+            m_remaining -= str.size();
+
+            return {copy, str.size()};
+        }
+
+    private:
+        //! The size of a block. Big enough to keep the number of allocations low for typical module/path names.
+        static constexpr std::size_t blockSize = std::size_t{64} * 1024;
+
+        //! All allocated blocks.
+        std::vector< std::unique_ptr< char[] > > m_blocks; // NOLINT: raw arrays are what we want here.
+
+        //! Current write position in the last block
+        char* m_head = nullptr;
+
+        //! Remaining bytes in the last block
+        std::size_t m_remaining = 0;
+    };
+
+    /**
+     * Maps strings to compact IDs. Each unique string is stored exactly once and can be looked up by ID in O(1) and by
+     * name in amortized O(1) through a hash index.
+     *
+     * The index is split into shards by the hash of the strings, each with a lock and an arena of its own. Threads
+     * interning different strings rarely wait for each other. IDs are handed out by an atomic counter. The strings of
+     * the IDs are kept in segments that never move, each one twice as large as the one before.
+     *
+     * @ref intern and @ref find are thread-safe. @ref view is safe for IDs that were returned to the calling thread
+     * or to a thread it synchronized with. @ref size is not synchronized with concurrent calls to @ref intern. Use it
+     * once all producers are done.
+     */
+    class Interner
+    {
+    public:
+        Interner() = default;
+        Interner(const Interner&) = delete;
+        Interner(Interner&&) = delete;
+        Interner& operator=(const Interner&) = delete;
+        Interner& operator=(Interner&&) = delete;
+        ~Interner() = default;
+
+        /**
+         * Get the ID of the given string. If the string is not yet known, it gets a new ID.
+         *
+         * @param str The string to intern
+         *
+         * @return The ID of the string
+         */
+        [[nodiscard]] SymbolId intern(std::string_view str)
+        {
+            auto& shard = shardOf(str);
+            // Most names are seen many times. Try the cheap shared lock first.
+            {
+                std::shared_lock lock(shard.mutex);
+                if (auto it = shard.index.find(str); it != shard.index.end())
+                {
+                    return it->second;
+                }
+            }
+
+            std::unique_lock lock(shard.mutex);
+            // Someone might have added it in the mean time.
+            if (auto it = shard.index.find(str); it != shard.index.end())
+            {
+                return it->second;
+            }
+
+            auto id = m_size.fetch_add(1, std::memory_order_relaxed);
+            auto stored = shard.arena.store(str);
+            slot(id) = stored;
+            shard.index.emplace(stored, id);
+
+            return id;
+        }
+
+        /**
+         * Find the ID of a string without interning it.
+         *
+         * @param str The string to look for
+         *
+         * @return The ID or std::nullopt if the string was never interned.
+         */
+        [[nodiscard]] std::optional< SymbolId > find(std::string_view str) const
+        {
+            const auto& shard = shardOf(str);
+            std::shared_lock lock(shard.mutex);
+            if (auto it = shard.index.find(str); it != shard.index.end())
+            {
+                return it->second;
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * Get the string of an ID.
+         *
+         * @param id The ID. Must have been returned by @ref intern.
+         *
+         * @return The string. The view is valid as long as this interner lives.
+         */
+        [[nodiscard]] std::string_view view(SymbolId id) const
+        {
+            auto [segment, offset] = locate(id);
+            return m_segments[segment].load(std::memory_order_acquire)[offset];
+        }
+
+        //! The number of interned strings. All IDs are smaller than this.
+        [[nodiscard]] std::size_t size() const
+        {
+            return m_size.load(std::memory_order_relaxed);
+        }
+
+    private:
+        //! The number of shards is 2 to the power of this
+        static constexpr std::size_t numShardBits = 4;
+
+        //! The number of shards
+        static constexpr std::size_t numShards = std::size_t{1} << numShardBits;
+
+        //! The number of IDs in the first segment. Each following segment holds twice as many.
+        static constexpr std::size_t firstSegmentSize = 1024;
+
+        //! Enough segments for all 32 bit IDs
+        static constexpr std::size_t numSegments = 24;
+
+        //! A part of the index. Aligned to a cache line, so threads working on different shards do not collide.
+        struct alignas(64) Shard
+        {
+            //! Guards the shard
+            mutable std::shared_mutex mutex;
+
+            //! Where the string data of this shard lives
+            StringArena arena;
+
+            //! String to ID. The keys point into the arena.
+            std::unordered_map< std::string_view, SymbolId > index;
+        };
+
+        //! The shards of the index
+        std::array< Shard, numShards > m_shards;
+
+        //! The next ID
+        std::atomic< SymbolId > m_size = 0;
+
+        //! ID to string, in segments. The views point into the arenas. Segments are only added, never moved.
+        std::array< std::atomic< std::string_view* >, numSegments > m_segments{};
+
+        //! Owns the segments
+        std::array< std::unique_ptr< std::string_view[] >, numSegments > m_segmentData; // NOLINT: fixed size arrays.
+
+        //! Guards adding segments
+        std::mutex m_segmentMutex;
+
+        //! The shard of a string. Picked by the upper bits of the hash, the index of the shard uses the lower ones.
+        [[nodiscard]] static std::size_t shardIndex(std::string_view str)
+        {
+            return std::hash< std::string_view >{}(str) >> (std::numeric_limits< std::size_t >::digits - numShardBits);
+        }
+
+        //! The shard of a string
+        [[nodiscard]] Shard& shardOf(std::string_view str)
+        {
+            return m_shards[shardIndex(str)];
+        }
+
+        //! The shard of a string
+        [[nodiscard]] const Shard& shardOf(std::string_view str) const
+        {
+            return m_shards[shardIndex(str)];
+        }
+
+        //! The segment of an ID and its offset therein
+        [[nodiscard]] static std::pair< std::size_t, std::size_t > locate(SymbolId id)
+        {
+            const std::size_t segment = std::bit_width(id / firstSegmentSize + 1) - 1;
+            return {segment, id - (firstSegmentSize * ((std::size_t{1} << segment) - 1))};
+        }
+
+        //! The slot of an ID. Adds its segment, if needed.
+        [[nodiscard]] std::string_view& slot(SymbolId id)
+        {
+            auto [segment, offset] = locate(id);
+            auto* data = m_segments[segment].load(std::memory_order_acquire);
+            if (data == nullptr)
+            {
+                const std::scoped_lock lock(m_segmentMutex);
+                data = m_segments[segment].load(std::memory_order_relaxed);
+                if (data == nullptr)
+                {
+                    m_segmentData[segment] = std::make_unique< std::string_view[] >(firstSegmentSize << segment);
+                    data = m_segmentData[segment].get();
+                    m_segments[segment].store(data, std::memory_order_release);
+                }
+            }
+            return data[offset]; // NOLINT: the offset is within the segment.
+        }
+    };
+
+    //! The interned names used by a module graph. Module names and file paths are kept apart to keep the IDs dense.
+    struct Symbols
+    {
+        //! Logical module and partition names
+        Interner modules;
+
+        //! Source files and compilation outputs
+        Interner paths;
+    };
+} // namespace mgt
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace mgt
+{
+    /**
+     * The basics of a minimal, streaming JSON parser. Derived readers walk the document with @ref parseObject and
+     * @ref parseArray, pick the values they are interested in and skip everything else with @ref skipValue. No
+     * intermediate representation is built.
+     *
+     * Strings are returned as views into the document. Only strings that contain escape sequences need a copy, which
+     * is kept alive by the reader.
+     */
+    class JsonReader
+    {
+    protected:
+        /**
+         * Create a reader for the given JSON document.
+         *
+         * @param json The document. Must outlive the reader.
+         */
+        explicit JsonReader(std::string_view json) : m_json(json)
+        {
+        }
+
+        //! Fail if there is anything but whitespace left in the document.
+        void expectEnd()
+        {
+            skipWhitespace();
+            if (m_pos != m_json.size())
+            {
+                fail("unexpected content after the document");
+            }
+        }
+
+        /**
+         * Throw a parse error with the current position.
+         *
+         * @param what The description of the error.
+         */
+        [[noreturn]] void fail(std::string_view what) const
+        {
+            auto consumed = m_json.substr(0, std::min(m_pos, m_json.size()));
+            auto line = std::ranges::count(consumed, '\n') + 1;
+            auto lineStart = consumed.rfind('\n');
+            auto column = (lineStart == std::string_view::npos) ? consumed.size() + 1 : consumed.size() - lineStart;
+
+            throw std::runtime_error(std::format("parse error at line {}, column {}: {}", line, column, what));
+        }
+
+        void skipWhitespace()
+        {
+            while (m_pos < m_json.size())
+            {
+                auto c = m_json[m_pos];
+                if ((c != ' ') && (c != '\n') && (c != '\r') && (c != '\t'))
+                {
+                    return;
+                }
+                ++m_pos;
+            }
+        }
+
+        //! The next non-whitespace character or 0 at the end of the document.
+        [[nodiscard]] char peek()
+        {
+            skipWhitespace();
+            return (m_pos < m_json.size()) ? m_json[m_pos] : '\0';
+        }
+
+        void expect(char c)
+        {
+            if (peek() != c)
+            {
+                fail(std::format("expected '{}'", c));
+            }
+            ++m_pos;
+        }
+
+        /**
+         * Parse an object and call the given function for each key. The function must consume the value.
+         *
+         * @param onMember Called with the key. The read position is at the value.
+         */
+        template < typename Func >
+        void parseObject(Func&& onMember)
+        {
+            expect('{');
+            if (peek() == '}')
+            {
+                ++m_pos;
+                return;
+            }
+
+            while (true)
+            {
+                auto key = parseString();
+                expect(':');
+                onMember(key);
+
+                if (peek() == ',')
+                {
+                    ++m_pos;
+                    continue;
+                }
+                expect('}');
+                return;
+            }
+        }
+
+        /**
+         * Parse an array and call the given function for each element. The function must consume the element.
+         *
+         * @param onElement Called for each element. The read position is at the element.
+         */
+        template < typename Func >
+        void parseArray(Func&& onElement)
+        {
+            expect('[');
+            if (peek() == ']')
+            {
+                ++m_pos;
+                return;
+            }
+
+            while (true)
+            {
+                onElement();
+
+                if (peek() == ',')
+                {
+                    ++m_pos;
+                    continue;
+                }
+                expect(']');
+                return;
+            }
+        }
+
+        /**
+         * Parse a string.
+         *
+         * @return A view into the document or, if the string contains escape sequences, into an unescaped copy.
+         */
+        [[nodiscard]] std::string_view parseString()
+        {
+            expect('"');
+            auto start = m_pos;
+
+            // Fast path: no escapes. Find the closing quote.
+            while (m_pos < m_json.size())
+            {
+                auto c = m_json[m_pos];
+                if (c == '"')
+                {
+                    return m_json.substr(start, m_pos++ - start);
+                }
+                if (c == '\\')
+                {
+                    return parseEscapedString(start);
+                }
+                ++m_pos;
+            }
+
+            fail("unterminated string");
+        }
+
+        /**
+         * Continue parsing a string that contains escape sequences.
+         *
+         * @param start The position of the first character of the string.
+         *
+         * @return A view into an unescaped copy.
+         */
+        [[nodiscard]] std::string_view parseEscapedString(std::size_t start)
+        {
+            auto& result = m_unescaped.emplace_back(m_json.substr(start, m_pos - start));
+            while (m_pos < m_json.size())
+            {
+                auto c = m_json[m_pos++];
+                if (c == '"')
+                {
+                    return result;
+                }
+                if (c != '\\')
+                {
+                    result.push_back(c);
+                    continue;
+                }
+
+                if (m_pos >= m_json.size())
+                {
+                    break;
+                }
+
+                switch (auto escaped = m_json[m_pos++])
+                {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        result.push_back(escaped);
+                        break;
+                    case 'b':
+                        result.push_back('\b');
+                        break;
+                    case 'f':
+                        result.push_back('\f');
+                        break;
+                    case 'n':
+                        result.push_back('\n');
+                        break;
+                    case 'r':
+                        result.push_back('\r');
+                        break;
+                    case 't':
+                        result.push_back('\t');
+                        break;
+                    case 'u':
+                        appendCodePoint(result);
+                        break;
+                    default:
+                        fail("invalid escape sequence");
+                }
+            }
+
+            fail("unterminated string");
+        }
+
+        //! Parse the 4 hex digits of a \u escape.
+        [[nodiscard]] std::uint32_t parseHex4()
+        {
+            std::uint32_t value = 0;
+            auto digits = m_json.substr(m_pos, 4);
+            auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), value, 16);
+            if ((digits.size() != 4) || (error != std::errc{}) ||
+                (end != digits.data() + digits.size())) // NOLINT: pointer arithmetic is fine here.
+            {
+                fail("invalid unicode escape");
+            }
+            m_pos += 4;
+            return value;
+        }
+
+        //! Parse the code point of a \u escape (incl. surrogate pairs) and append it as UTF-8.
+        void appendCodePoint(std::string& out)
+        {
+            auto codePoint = parseHex4();
+            if ((codePoint >= 0xD800) && (codePoint <= 0xDBFF))
+            {
+                if (!m_json.substr(m_pos).starts_with("\\u"))
+                {
+                    fail("invalid unicode surrogate pair");
+                }
+                m_pos += 2;
+                auto low = parseHex4();
+                if ((low < 0xDC00) || (low > 0xDFFF))
+                {
+                    fail("invalid unicode surrogate pair");
+                }
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+            }
+
+            auto put = [&](std::uint32_t byte) { out.push_back(static_cast< char >(byte)); };
+            if (codePoint < 0x80)
+            {
+                put(codePoint);
+            }
+            else if (codePoint < 0x800)
+            {
+                put(0xC0 | (codePoint >> 6));
+                put(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000)
+            {
+                put(0xE0 | (codePoint >> 12));
+                put(0x80 | ((codePoint >> 6) & 0x3F));
+                put(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                put(0xF0 | (codePoint >> 18));
+                put(0x80 | ((codePoint >> 12) & 0x3F));
+                put(0x80 | ((codePoint >> 6) & 0x3F));
+                put(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        //! Consume a number and return its text.
+        [[nodiscard]] std::string_view parseNumber()
+        {
+            skipWhitespace();
+            auto start = m_pos;
+            while ((m_pos < m_json.size()) && (std::string_view("+-.0123456789eE").find(m_json[m_pos]) !=
+                                               std::string_view::npos))
+            {
+                ++m_pos;
+            }
+
+            if (start == m_pos)
+            {
+                fail("expected a number");
+            }
+            return m_json.substr(start, m_pos - start);
+        }
+
+        [[nodiscard]] int parseInteger()
+        {
+            auto number = parseNumber();
+            int value = 0;
+            auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), value);
+            if ((error != std::errc{}) || (end != number.data() + number.size())) // NOLINT: pointer arithmetic.
+            {
+                fail("expected an integer");
+            }
+            return value;
+        }
+
+        //! Consume the given literal (true, false, null).
+        void parseLiteral(std::string_view literal)
+        {
+            if (!m_json.substr(m_pos).starts_with(literal))
+            {
+                fail("invalid literal");
+            }
+            m_pos += literal.size();
+        }
+
+        //! Skip any JSON value.
+        void skipValue()
+        {
+            switch (peek())
+            {
+                case '{':
+                    parseObject([this](std::string_view) { skipValue(); });
+                    break;
+                case '[':
+                    parseArray([this] { skipValue(); });
+                    break;
+                case '"':
+                    static_cast< void >(parseString());
+                    break;
+                case 't':
+                    parseLiteral("true");
+                    break;
+                case 'f':
+                    parseLiteral("false");
+                    break;
+                case 'n':
+                    parseLiteral("null");
+                    break;
+                default:
+                    static_cast< void >(parseNumber());
+            }
+        }
+
+    private:
+        //! The document
+        std::string_view m_json;
+
+        //! The current read position
+        std::size_t m_pos = 0;
+
+        //! Storage for strings that had to be unescaped. A deque keeps the strings (and views to them) stable.
+        std::deque< std::string > m_unescaped;
+    };
+} // namespace mgt
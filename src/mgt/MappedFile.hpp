@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define MGT_HAVE_MMAP 1
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #include <fstream>
+    #include <iterator>
+#endif
+
+namespace mgt
+{
+    /**
+     * A read-only view of a whole file. On POSIX systems, large files are memory-mapped. Small files (like almost all
+     * DDI files) are read into a buffer, as setting up and tearing down a mapping costs more than copying a few KiB.
+     * Everywhere else, the file is read into memory.
+     */
+    class MappedFile
+    {
+    public:
+        /**
+         * Map the given file.
+         *
+         * @throw std::runtime_error If the file cannot be opened or mapped.
+         *
+         * @param path The file to map
+         */
+        explicit MappedFile(const std::filesystem::path& path)
+        {
+#ifdef MGT_HAVE_MMAP
+            auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC); // NOLINT: vararg C API.
+            if (fd < 0)
+            {
+                throw std::runtime_error(std::format("Cannot open file: {}", std::strerror(errno)));
+            }
+
+            struct stat info
+            {
+            };
+
+            if (::fstat(fd, &info) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error(std::format("Cannot stat file: {}", std::strerror(errno)));
+            }
+
+            auto size = static_cast< std::size_t >(info.st_size);
+            if (size < mapThreshold)
+            {
+                m_buffer.resize(size);
+                std::size_t numRead = 0;
+                while (numRead < size)
+                {
+                    auto result = ::read(fd, m_buffer.data() + numRead, size - numRead); // NOLINT: pointer arithmetic.
+                    if (result <= 0)
+                    {
+                        // The file might have been truncated in the mean time. Keep what we have.
+                        if ((result < 0) && (errno == EINTR))
+                        {
+                            continue;
+                        }
+                        m_buffer.resize(numRead);
+                        break;
+                    }
+                    numRead += static_cast< std::size_t >(result);
+                }
+            }
+            else
+            {
+                m_data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m_data == MAP_FAILED) // NOLINT: C-style cast in the macro.
+                {
+                    m_data = nullptr;
+                    ::close(fd);
+                    throw std::runtime_error(std::format("Cannot map file: {}", std::strerror(errno)));
+                }
+                m_size = size;
+            }
+
+            ::close(fd);
+#else
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+            {
+                throw std::runtime_error("Cannot open file.");
+            }
+            m_buffer.assign(std::istreambuf_iterator< char >(file), std::istreambuf_iterator< char >());
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+        ~MappedFile()
+        {
+#ifdef MGT_HAVE_MMAP
+            if (m_data != nullptr)
+            {
+                ::munmap(m_data, m_size);
+            }
+#endif
+        }
+
+        //! The contents of the file. Valid as long as this instance lives.
+        [[nodiscard]] std::string_view view() const
+        {
+#ifdef MGT_HAVE_MMAP
+            if (m_data != nullptr)
+            {
+                return {static_cast< const char* >(m_data), m_size};
+            }
+#endif
+            return m_buffer;
+        }
+
+    private:
+        //! Files smaller than this are read instead of mapped.
+        static constexpr std::size_t mapThreshold = std::size_t{256} * 1024;
+
+#ifdef MGT_HAVE_MMAP
+        //! The mapped memory. Null if the file was read into the buffer.
+        void* m_data = nullptr;
+
+        //! The size of the mapping
+        std::size_t m_size = 0;
+#endif
+
+        //! The file contents, if not mapped.
+        std::string m_buffer;
+    };
+} // namespace mgt
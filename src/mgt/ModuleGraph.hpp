@@ -1,24 +1,44 @@
 #pragma once
 
+#include "CSRGraph.hpp"
+#include "Cache.hpp"
+#include "CriticalPath.hpp"
+#include "Cycles.hpp"
 #include "DDI.hpp"
-
-#include <graaflib/algorithm/shortest_path/bfs_shortest_path.h>
-#include <graaflib/algorithm/shortest_path/dijkstra_shortest_path.h>
-#include <graaflib/algorithm/strongly_connected_components/tarjan.h>
-#include <graaflib/graph.h>
-#include <graaflib/io/dot.h>
-#include <graaflib/types.h>
+#include "Dot.hpp"
+#include "Interner.hpp"
+#include "NinjaLog.hpp"
+#include "Parallel.hpp"
+#include "Profile.hpp"
+#include "Reachability.hpp"
+#include "Report.hpp"
+#include "SCC.hpp"
+#include "Snapshot.hpp"
+#include "TransitiveReduction.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <exception>
 #include <filesystem>
-#include <list>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <ranges>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <variant>
 #include <vector>
 
 namespace mgt
@@ -29,67 +49,76 @@ namespace mgt
      */
     struct ModuleInfo
     {
-        //! The logical name of the module
-        std::string name;
+        //! The logical name of the module. Interned in @ref Symbols::modules.
+        ModuleId name = 0;
 
         //! A list of source files that provide this module. This should only be one. If you have some setup that
         //! re-combines stuff in different libs, it might happen that different sources provide the same module.
-        std::vector< std::string > providedBy;
+        //! Interned in @ref Symbols::paths.
+        std::vector< PathId > providedBy;
 
-        //! A list of compilation units that require this module.
-        std::vector< std::string > requiredBy;
+        //! A list of compilation units that require this module. Interned in @ref Symbols::paths.
+        std::vector< PathId > requiredBy;
 
-        /**
-         * Merges information from one node into this one. The names must match.
-         *
-         * @throw std::runtime_error If the names do not match.
-         *
-         * @param rhs The node to merge in
-         * @return This node
-         */
-        ModuleInfo& operator+=(const ModuleInfo& rhs)
-        {
-            if (name != rhs.name)
-            {
-                throw std::runtime_error("Cannot merge nodes with different names.");
-            }
-
-            providedBy.insert(providedBy.end(), rhs.providedBy.begin(), rhs.providedBy.end());
-            requiredBy.insert(requiredBy.end(), rhs.requiredBy.begin(), rhs.requiredBy.end());
-
-            return *this;
-        }
+        //! The compilation outputs of the sources that provide this module. Interned in @ref Symbols::paths.
+        std::vector< PathId > outputs;
     };
 
-    //! The edge between module nodes
-    struct Edge
-    {
-    };
-
-    //! Metrics that can be derived for each node (each @ref ModuleInfo)
+    /**
+     * Metrics that can be derived for each node (each @ref ModuleInfo). Kept small, as the metrics of all nodes are
+     * stored in a dense table indexed by vertex ID.
+     */
     struct ModuleMetrics
     {
-        //! Number of incoming edges - aka the number of nodes that require this node.
-        std::size_t numIn = 0;
+        //! Marks a node that is not part of any SCC
+        static constexpr std::uint32_t noSCC = std::numeric_limits< std::uint32_t >::max();
+
+        //! Number of incoming edges - aka the number of nodes that require this node. Includes the consumers.
+        std::uint32_t numIn = 0;
         //! Number of outgoing edges - aka the number of nodes this node requires.
-        std::size_t numOut = 0;
+        std::uint32_t numOut = 0;
+
+        /**
+         * The index of the strongly connected component group the node is part of, or @ref noSCC. Note: 2 SCCs are
+         * pair-wise disjoint -> no overlap possible.
+         */
+        std::uint32_t scc = noSCC;
 
         //! Is true if the module is not provided by any source file
-        bool isMissing = false;
+        bool isMissing : 1 = false;
         //! Is true, if the node is not required by any other module
-        bool isSource = false;
+        bool isSource : 1 = false;
         //! Is true, if the node is not consumed by any other module
-        bool isSink = false;
+        bool isSink : 1 = false;
         //! If the node has no requirements and is not required by any other module.
-        bool isDisconnected = false;
-
-        /**
-         * If the node is part of a strongly connected component group. Note: 2 SCCs are pair-wise disjoint -> no
-         * overlap possible.
-         */
-        bool isSCC = false;
+        bool isDisconnected : 1 = false;
         //! True for a node that is in the shortest cycle of its SCC.
-        bool isInShortestCycle = false;
+        bool isInShortestCycle : 1 = false;
+
+        //! If the node is part of a strongly connected component group.
+        [[nodiscard]] bool isSCC() const
+        {
+            return scc != noSCC;
+        }
+    };
+
+    //! Options that control how a @ref ModuleGraph gets loaded.
+    struct LoadOptions
+    {
+        //! The number of threads to use for loading the DDI files
+        unsigned jobs = 1;
+
+        //! If set, loaded DDI files and analysis results are cached in this file to speed up subsequent runs.
+        std::optional< std::filesystem::path > cacheFile;
+
+        //! The max. number of distinct shortest cycles to find per SCC.
+        std::size_t cyclesPerSCC = 1;
+
+        //! If true, build the reachability index needed by @ref ModuleGraph::impact. It is cached as well.
+        bool reachability = false;
+
+        //! If true, translation units that import modules without providing one are part of the graph, as consumers.
+        bool consumers = true;
     };
 
     //! Represents the loaded module requirements graph and provides some tools to work with it.
@@ -100,185 +129,722 @@ namespace mgt
          * Load all DDI files from a given path and build a module graph out of them,
          *
          * @param root The directory where to load the DDI
+         * @param options Control the loading process. See @ref LoadOptions.
          *
          * @return The graph
          */
-        [[nodiscard]] static ModuleGraph make(const std::filesystem::path& root)
+        [[nodiscard]] static ModuleGraph make(const std::filesystem::path& root, const LoadOptions& options = {})
+        {
+            auto symbols = std::make_shared< Symbols >();
+
+            AnalysisCache cache;
+            if (options.cacheFile)
+            {
+                const ScopedTimer timer("cache: load");
+                cache = AnalysisCache::load(*options.cacheFile, *symbols);
+            }
+
+            auto loaded = mgt::ddi::load(root, *symbols, options.jobs,
+                                         options.cacheFile ? cache.lookup() : mgt::ddi::CacheLookup{});
+            auto result = make(root, std::move(symbols), loaded.ddis, options, &cache);
+
+            if (options.cacheFile)
+            {
+                result.m_cacheStats = {.hits = loaded.cacheHits, .misses = loaded.cacheMisses};
+                const ScopedTimer timer("cache: save");
+                result.saveCache(cache, loaded.ddis, *options.cacheFile);
+            }
+            result.m_loadTimes = loaded.times;
+
+            // Keep the DDI around to allow updating the graph later on.
+            result.m_ddis = std::move(loaded.ddis);
+            return result;
+        }
+
+        /**
+         * Build a module graph out of DDI that have been loaded already. Used to build several graphs out of one set
+         * of loaded DDI files, like one graph per target of a build. The graph does not keep the DDI, hence it cannot
+         * be updated with @ref update.
+         *
+         * @param path The location the DDI have been loaded from. Only used for the report.
+         * @param symbols The symbol tables all DDI are interned in. Shared with the graph.
+         * @param ddis The DDI to build the graph from
+         * @param options The number of jobs and cycles per SCC. The cache file is ignored.
+         * @param cache Optional. If its analysis results match the graph, they are used instead of analyzing again.
+         *
+         * @return The graph
+         */
+        [[nodiscard]] static ModuleGraph make(std::filesystem::path path, std::shared_ptr< Symbols > symbols,
+                                              std::span< const ddi::DDI > ddis, const LoadOptions& options,
+                                              const AnalysisCache* cache = nullptr)
+        {
+            ModuleGraph result(std::move(path));
+            result.m_symbols = std::move(symbols);
+            result.m_jobs = options.jobs;
+            result.m_cyclesPerSCC = std::max< std::size_t >(1, options.cyclesPerSCC);
+            result.m_withReachability = options.reachability;
+            result.m_withConsumers = options.consumers;
+            {
+                const ScopedTimer timer("graph: build");
+                result.build(ddis);
+            }
+
+            // The SCCs and cycles only depend on the edges. If they did not change, re-use the previous results.
+            const auto* cachedAnalysis =
+                (cache != nullptr) ? cache->analysis(result.moduleEdges(), result.m_cyclesPerSCC) : nullptr;
+            if (cachedAnalysis != nullptr)
+            {
+                const ScopedTimer timer("analysis: restore from cache");
+                result.restore(*cachedAnalysis);
+            }
+            else
+            {
+                result.analyze();
+            }
+            result.indexReachability();
+            result.computeMetrics();
+            result.countProfile();
+
+            return result;
+        }
+
+        /**
+         * Store the DDI and the analysis results of this graph in a cache and write it. Nothing is written if the
+         * cache is up to date already. Failing to write the cache is not fatal, only a warning is printed.
+         *
+         * @param cache The cache to update
+         * @param ddis All DDI the graph was built from
+         * @param file The cache file
+         */
+        void saveCache(AnalysisCache& cache, const std::vector< ddi::DDI >& ddis,
+                       const std::filesystem::path& file) const
         {
-            // Creates a node or merges it with an existing one.
-            auto getOrCreateNode = [](auto& graph, ModuleInfo info)
+            auto edges = moduleEdges();
+            const auto* cached = cache.analysis(edges, m_cyclesPerSCC);
+            if ((cached != nullptr) && (cached->reachability.has_value() || !m_reachability) && cache.isCurrent(ddis))
             {
-                for (const auto& [id, moduleInfo] : graph.get_vertices())
+                return;
+            }
+
+            cache.update(ddis, analysis(std::move(edges)));
+            try
+            {
+                cache.save(file, *m_symbols);
+            }
+            catch (std::exception& e)
+            {
+                std::cerr << std::format("W: Failed to write the cache ({}). Error: {}\n", file.string(), e.what());
+            }
+        }
+
+        /**
+         * Re-load the given DDI files and update the graph. Files that do not exist anymore are removed from the
+         * graph. The graph is re-built from the DDI kept in memory. The SCCs and cycles are only re-calculated if the
+         * edges changed.
+         *
+         * @param files The changed DDI files. Paths must be spelled like the paths found by @ref make.
+         */
+        void update(const std::vector< std::filesystem::path >& files)
+        {
+            auto previous = analysis(moduleEdges());
+
+            std::unordered_map< std::string, std::size_t > index;
+            for (std::size_t i = 0; i < m_ddis.size(); ++i)
+            {
+                index.emplace(m_ddis[i].path.string(), i);
+            }
+
+            std::vector< bool > removed(m_ddis.size(), false);
+            for (const auto& file : files)
+            {
+                // Files that fail to load are treated like removed files, as in @ref make.
+                std::optional< ddi::DDI > loaded;
+                if (std::filesystem::exists(file))
+                {
+                    auto result = ddi::loadFile(file, m_path, *m_symbols);
+                    if (const auto* error = std::get_if< std::string >(&result))
+                    {
+                        std::cerr << *error << "\n";
+                    }
+                    else
+                    {
+                        loaded = std::move(std::get< ddi::DDI >(result));
+                    }
+                }
+
+                auto it = index.find(file.string());
+                if (it == index.end())
                 {
-                    if (moduleInfo.name != info.name)
+                    if (loaded)
                     {
-                        continue;
+                        index.emplace(file.string(), m_ddis.size());
+                        m_ddis.push_back(std::move(*loaded));
+                        removed.push_back(false);
                     }
+                }
+                else if (loaded)
+                {
+                    m_ddis[it->second] = std::move(*loaded);
+                    removed[it->second] = false;
+                }
+                else
+                {
+                    removed[it->second] = true;
+                }
+            }
 
-                    graph.get_vertex(id) += info;
-                    return id;
+            std::size_t numKept = 0;
+            for (std::size_t i = 0; i < m_ddis.size(); ++i)
+            {
+                if (removed[i])
+                {
+                    continue;
+                }
+                if (numKept != i)
+                {
+                    m_ddis[numKept] = std::move(m_ddis[i]);
                 }
+                ++numKept;
+            }
+            m_ddis.resize(numKept);
 
-                return graph.add_vertex(info);
-            };
+            // Start over with the graph
+            m_graph = {};
+            m_modules.clear();
+            m_vertexOf.clear();
+            m_edgeSources.clear();
+            m_consumers.clear();
+            m_consumerGraph = {};
+            m_sccs.clear();
+            m_cycles.clear();
+            m_metrics.clear();
+            m_reachability.reset();
+            m_cacheStats.reset();
+            m_loadTimes.reset();
+
+            build(m_ddis);
+            if (moduleEdges() == previous.edges)
+            {
+                restore(previous);
+            }
+            else
+            {
+                analyze();
+            }
+            indexReachability();
+            computeMetrics();
+        }
+
+        /**
+         * The issues found in the graph, in terms of module names and paths. Comparable between different builds of the
+         * graph, even if they have different symbol tables: IDs depend on the order in which names were interned.
+         */
+        struct Diagnostics
+        {
+            //! Modules provided by more than one source, with their (sorted) sources. Sorted by module.
+            std::vector< std::pair< std::string, std::vector< std::string > > > multipleProviders;
+            //! Modules without a source. Sorted.
+            std::vector< std::string > missing;
+            //! The SCCs. Each SCC is sorted, the list of SCCs too.
+            std::vector< std::vector< std::string > > sccs;
+
+            bool operator==(const Diagnostics&) const = default;
+        };
+
+        //! Collect the issues found in the graph. See @ref Diagnostics.
+        [[nodiscard]] Diagnostics diagnostics() const
+        {
+            Diagnostics result;
+            for (VertexId vertexId = 0; vertexId < m_modules.size(); ++vertexId)
+            {
+                const auto& moduleInfo = m_modules[vertexId];
+                if (moduleInfo.providedBy.size() > 1)
+                {
+                    auto providers = moduleInfo.providedBy |
+                                     std::views::transform([&](PathId path)
+                                                           { return std::string(m_symbols->paths.view(path)); }) |
+                                     std::ranges::to< std::vector >();
+                    std::ranges::sort(providers);
+                    result.multipleProviders.emplace_back(nameOf(vertexId), std::move(providers));
+                }
+                else if (m_metrics[vertexId].isMissing)
+                {
+                    result.missing.emplace_back(nameOf(vertexId));
+                }
+            }
 
-            ModuleGraph result(root);
+            for (const auto& scc : m_sccs)
+            {
+                auto modules = scc | std::views::transform([&](const auto& id) { return std::string(nameOf(id)); }) |
+                               std::ranges::to< std::vector >();
+                std::ranges::sort(modules);
+                result.sccs.push_back(std::move(modules));
+            }
+
+            std::ranges::sort(result.multipleProviders);
+            std::ranges::sort(result.missing);
+            std::ranges::sort(result.sccs);
+            return result;
+        }
+
+        //! The number of loaded DDI files.
+        [[nodiscard]] std::size_t numFiles() const
+        {
+            return m_ddis.size();
+        }
+
+        //! The number of modules, aka nodes, in the graph.
+        [[nodiscard]] std::size_t numModules() const
+        {
+            return m_modules.size();
+        }
+
+        //! The number of consumers: translation units that import modules, but do not provide one.
+        [[nodiscard]] std::size_t numConsumers() const
+        {
+            return m_consumers.size();
+        }
+
+        //! The SCCs and shortest cycles of the graph in terms of module IDs.
+        [[nodiscard]] AnalysisCache::Analysis analysis() const
+        {
+            return analysis(moduleEdges());
+        }
+
+        //! The symbol tables the module IDs and path IDs of this graph refer to.
+        [[nodiscard]] const Symbols& symbols() const
+        {
+            return *m_symbols;
+        }
+
+        /**
+         * Collect the summary and the issues of this graph: modules with multiple sources, missing modules and circular
+         * dependencies with their shortest cycles. The report refers to the names of this graph.
+         */
+        [[nodiscard]] Report report() const
+        {
+            Report result;
+            auto& summary = result.summary();
+            summary.path = m_path.string();
+            summary.numFiles = m_ddis.size();
+            summary.loadTimes = m_loadTimes;
+            if (m_cacheStats)
+            {
+                summary.cacheStats = {.hits = m_cacheStats->hits, .misses = m_cacheStats->misses};
+            }
+            summary.numModules = m_modules.size();
+            summary.numConsumers = m_consumers.size();
 
-            // Transform the DDI info to a graph. This allows for easy application of graph algorithms to find issues
-            // hidden within.
-            auto& graph = result.m_graph;
-            // Yeewww a deeply nested set of for-loops. My nerdy-senses tell me to replace this with a long sequence of
-            // std::range transforms, joins and zips. However, my inner pragmatic programmer tells me that the mental
-            // load required to read nested loops is way way lower than the ranges version. So, nested loops it is.
-            for (const auto& ddi : mgt::ddi::load(root))
+            // Multiple sources for a module, or none at all?
+            for (VertexId vertexId = 0; vertexId < m_modules.size(); ++vertexId)
             {
-                for (const auto& rule : ddi.rules)
+                const auto& moduleInfo = m_modules[vertexId];
+                if (moduleInfo.providedBy.size() > 1)
                 {
-                    for (const auto& provide : rule.provides)
+                    result.add(codes::multipleSources, nameOf(vertexId));
+                    for (auto source : moduleInfo.providedBy)
                     {
-                        auto pid = getOrCreateNode(
-                            graph, {.name = provide.logicalName, .providedBy = {provide.sourcePath}, .requiredBy = {}});
-
-                        std::ranges::for_each(rule.requires_,
-                                              [&](const mgt::ddi::DDI::Require& req)
-                                              {
-                                                  auto rid =
-                                                      getOrCreateNode(graph, {.name = req.logicalName,
-                                                                              .providedBy = {},
-                                                                              .requiredBy = {rule.primaryOutput}});
-
-                                                  // As this is a requirement-graph, the arrows point towards the
-                                                  // required component.
-                                                  graph.add_edge(pid, rid, Edge{});
-                                              });
+                        result.addSource(m_symbols->paths.view(source));
                     }
                 }
+                else if (m_metrics[vertexId].isMissing)
+                {
+                    result.add(codes::missingModule, nameOf(vertexId));
+                }
             }
 
-            // The strongest connected components indicate cycles in the requirement-graph.
-            result.m_sccs = graaf::algorithm::tarjans_strongly_connected_components(graph) |
-                            std::views::filter([](const auto& scc) -> bool { return scc.size() > 1; }) |
-                            std::ranges::to< std::vector >();
-
-            // Using the SCC, calculate the shortest cycle in each SCC
-            for (const auto& scc : result.m_sccs)
-            {
-                NodeList shortest{};
-                for (const auto& id : scc)
-                {
-                    for (const auto& neighbourId :
-                         // For each neighbour,
-                         graph.get_neighbors(id) |
-                             // That is in this SCC
-                             std::views::filter([&](const auto& neighbourId)
-                                                { return std::ranges::contains(scc, neighbourId); }))
+            auto names = std::views::transform([&](VertexId vertexId) { return nameOf(vertexId); });
+            for (std::size_t i = 0; i < m_sccs.size(); ++i)
+            {
+                result.add(codes::circularDependency);
+                result.setModules(m_sccs[i] | names);
+                for (const auto& cycle : m_cycles.at(i))
+                {
+                    result.addCycle(cycle | names);
+                }
+            }
+
+            return result;
+        }
+
+        /**
+         * Prints a report about this module graph. Outputs warnings, SCCs and cycles. See @ref report.
+         *
+         * @param format The format to print in
+         */
+        void printReport(OutputFormat format = OutputFormat::text) const
+        {
+            report().write(std::cout, format);
+        }
+
+        /**
+         * Prints how well the modules can be built in parallel: the critical path through the modules with SCCs
+         * collapsed, the number of modules that can be built at the same time and the dependencies whose removal
+         * shortens the critical path the most. See @ref findCriticalPath.
+         *
+         * @throw std::runtime_error If the log cannot be read.
+         *
+         * @param ninjaLog Optional. Weight each module and consumer with the compile time of its outputs, as logged by
+         * Ninja. Without it, each one counts as one compilation.
+         */
+        void printCriticalPath(const std::optional< std::filesystem::path >& ninjaLog) const
+        {
+            // Consumers are compiled after the modules they import. They are the last vertices of the graph.
+            auto graph = withConsumers();
+            auto numVertices = graph.numVertices();
+            auto outputsOf = [&](VertexId vertexId)
+            {
+                return (vertexId < m_modules.size())
+                           ? std::span< const PathId >(m_modules[vertexId].outputs)
+                           : std::span< const PathId >(&m_consumers[vertexId - m_modules.size()], 1);
+            };
+
+            // Modules without source are not compiled. They do not add anything.
+            std::vector< bool > isCompiled(numVertices, true);
+            for (VertexId vertexId = 0; vertexId < m_modules.size(); ++vertexId)
+            {
+                isCompiled[vertexId] = !m_modules[vertexId].providedBy.empty();
+            }
+            std::vector< double > weights(numVertices, 0);
+            for (VertexId vertexId = 0; vertexId < numVertices; ++vertexId)
+            {
+                weights[vertexId] = isCompiled[vertexId] ? 1 : 0;
+            }
+
+            std::string weighting = "each module or translation unit counts as one compilation";
+            bool haveTimes = false;
+            auto amount = [&](double value)
+            { return haveTimes ? std::format("{:.0f} ms", value) : std::format("{:.0f} compilation(s)", value); };
+            if (ninjaLog)
+            {
+                auto times = readNinjaLog(*ninjaLog);
+
+                std::size_t numCompiled = 0;
+                std::size_t numFound = 0;
+                double sum = 0;
+                std::vector< bool > found(numVertices, false);
+                for (VertexId vertexId = 0; vertexId < numVertices; ++vertexId)
+                {
+                    if (isCompiled[vertexId])
                     {
-                        auto shortestPath =
-                            graaf::algorithm::bfs_shortest_path(result.m_graph, neighbourId, id).value().vertices;
-                        shortestPath.push_back(neighbourId); // closes the loop
+                        numCompiled++;
+                    }
 
-                        if (shortest.empty() || (shortest.size() > shortestPath.size()))
+                    double time = 0;
+                    for (auto output : outputsOf(vertexId))
+                    {
+                        auto key = std::filesystem::path(m_symbols->paths.view(output)).lexically_normal();
+                        if (auto it = times.find(key.generic_string()); it != times.end())
                         {
-                            shortest = shortestPath;
+                            time += it->second;
+                            found[vertexId] = true;
                         }
                     }
+                    if (found[vertexId])
+                    {
+                        weights[vertexId] = time;
+                        numFound++;
+                        sum += time;
+                    }
+                }
+
+                if (numFound == 0)
+                {
+                    std::cerr << std::format("W: No compilation output found in {}. Counting compilations instead.\n",
+                                             ninjaLog->string());
+                }
+                else
+                {
+                    // Outputs that have not been built yet get the average time.
+                    auto average = sum / static_cast< double >(numFound);
+                    for (VertexId vertexId = 0; vertexId < numVertices; ++vertexId)
+                    {
+                        if (!found[vertexId] && isCompiled[vertexId])
+                        {
+                            weights[vertexId] = average;
+                        }
+                    }
+
+                    weighting = std::format("compile times from {}, found for {} of {} compilations",
+                                            ninjaLog->string(), numFound, numCompiled);
+                    haveTimes = true;
                 }
-                result.m_cycles.emplace_back(std::move(shortest));
             }
 
-            // For each node, calculate some metrics per node. They only make sense in relation to the graph the node is
-            // in.
-            for (const auto& [vertexId, moduleInfo] : graph.get_vertices())
+            auto condensation = Condensation::make(graph, m_sccs);
+            auto result = findCriticalPath(condensation, weights, isCompiled);
+
+            // SCCs are shown in brackets
+            auto nameOfComponent = [&](std::uint32_t component)
             {
-                // const auto& moduleInfo = graph.get_vertex(vertexId);
-                auto numIn = moduleInfo.requiredBy.size();
-                auto numOut = graph.get_neighbors(vertexId).size();
+                const auto& vertices = condensation.components[component];
+                if (vertices.size() == 1)
+                {
+                    return std::string(nameOf(vertices.front()));
+                }
+                return std::format("[{}]", vertices |
+                                               std::views::transform([&](const auto& id) { return nameOf(id); }) |
+                                               std::views::join_with(std::string(", ")) |
+                                               std::ranges::to< std::string >());
+            };
 
-                result.m_metrics.insert(
-                    {vertexId,
-                     {
-                         .numIn = numIn,
-                         .numOut = numOut,
-                         .isMissing = moduleInfo.providedBy.size() == 0,
-                         .isSource = (numIn == 0) && (numOut != 0),
-                         .isSink = (numIn != 0) && (numOut == 0),
-                         .isDisconnected = (numIn + numOut) == 0, // = isSource && isSink
-                         .isSCC = std::ranges::any_of(result.m_sccs | std::views::join,
-                                                      [&](const auto& id) { return id == vertexId; }),
-                         .isInShortestCycle = std::ranges::any_of(result.m_cycles | std::views::join,
-                                                                  [&](const auto& id) { return id == vertexId; }),
-                     }});
+            std::size_t numOnPath = 0;
+            for (auto component : result.path)
+            {
+                numOnPath += condensation.components[component].size();
             }
 
-            return result;
+            std::cout << std::format("\nCritical path ({}):\n", weighting);
+            auto length = haveTimes ? std::format("{} in {} compilation(s)", amount(result.length), numOnPath)
+                                    : amount(static_cast< double >(numOnPath));
+            std::cout << std::format("   -> Length: {}, built first to last: {}\n", length,
+                                     result.path | std::views::transform(nameOfComponent) |
+                                         std::views::join_with(std::string(", ")) | std::ranges::to< std::string >());
+            std::cout << std::format("   -> Total work: {}, max. parallelism: {:.2f}\n", amount(result.totalWork),
+                                     result.parallelism());
+            std::cout << std::format("   -> Compilations per level: {}\n",
+                                     result.widthPerLevel |
+                                         std::views::transform([](auto width) { return std::to_string(width); }) |
+                                         std::views::join_with(std::string(", ")) | std::ranges::to< std::string >());
+
+            if (!result.cuts.empty())
+            {
+                std::cout << "   -> Dependencies that shorten the critical path the most if removed:\n";
+            }
+            for (const auto& cut : result.cuts)
+            {
+                std::cout << std::format("      {} -> {}: {} shorter\n", nameOfComponent(cut.from),
+                                         nameOfComponent(cut.to), amount(result.length - cut.length));
+            }
         }
 
         /**
-         * Prints a report about this module graph. Outputs warnings, SCCs and cycles.
+         * Prints the imports that are redundant, as the imported module is imported indirectly through another import
+         * already. These are the edges that are not part of the transitive reduction of the graph, see
+         * @ref findRedundantEdges. Removing them does not change the build order, but makes the dependencies easier to
+         * follow. Imports within an SCC are not considered. Imports of consumers are checked as well.
          */
-        void printReport()
+        void printRedundantImports() const
         {
-            std::cout << std::format("Report for {}\n\n", m_path.string());
+            auto graph = withConsumers();
+            auto condensation = Condensation::make(graph, m_sccs);
+            auto redundant = findRedundantEdges(graph, condensation, {.jobs = m_jobs});
 
-            auto numWarnings = 0;
-            auto numErrors = 0;
+            std::cout << std::format("\nRedundant imports: {} of {}\n", redundant.size(), graph.numEdges());
 
-            // Multiple sources for a module?
-            for (const auto& [_, moduleInfo] :
-                 m_graph.get_vertices() |
-                     std::views::filter([](const auto& v) { return v.second.providedBy.size() > 1; }))
+            // Grouped by the importing source. A module provided by several sources may import differently in each.
+            // Consumers are known by their output only.
+            std::vector< std::tuple< PathId, VertexId, const RedundantEdge* > > bySource;
+            for (const auto& edge : redundant)
             {
-                // C++23: std::print and formatting ranges not yet working everywhere.
-                std::cout << std::format("W: multiple sources for module \"{}\":\n   -> {}\n", moduleInfo.name,
-                                         moduleInfo.providedBy | std::views::join_with(std::string(", ")) |
-                                             std::ranges::to< std::string >());
-                numWarnings++;
+                if (edge.from >= m_modules.size())
+                {
+                    bySource.emplace_back(m_consumers[edge.from - m_modules.size()], edge.from, &edge);
+                    continue;
+                }
+
+                auto [first, last] = std::ranges::equal_range(
+                    m_edgeSources, std::pair(edge.from, edge.to),
+                    [](const auto& lhs, const auto& rhs) { return lhs < rhs; },
+                    [](const auto& entry) { return std::pair(std::get< 0 >(entry), std::get< 1 >(entry)); });
+                for (const auto& [from, to, source] : std::ranges::subrange(first, last))
+                {
+                    bySource.emplace_back(source, from, &edge);
+                }
             }
-            std::cout << (numWarnings > 0
-                              ? ("HINT: This is likely to be caused by multiple targets sharing the same module "
-                                 "code. Also, be sure to import module code instead of #including it.\n")
-                              : "");
+            auto sourceAndModule = [](const auto& entry)
+            { return std::pair(std::get< 0 >(entry), std::get< 1 >(entry)); };
+            std::ranges::stable_sort(bySource, {}, sourceAndModule);
 
-            // Missing source for a referenced module?
-            for (const auto& [_, moduleInfo] :
-                 m_graph.get_vertices() |
-                     std::views::filter([](const auto& v) { return v.second.providedBy.size() == 0; }))
+            for (auto it = bySource.begin(); it != bySource.end();)
             {
-                std::cout << std::format("E: No source provides the module: {}\n", moduleInfo.name);
-                numErrors++;
+                auto [source, from, edge] = *it;
+                std::cout << ((from < m_modules.size())
+                                  ? std::format("W: redundant imports in module \"{}\" ({}):\n", nameOf(from),
+                                                m_symbols->paths.view(source))
+                                  : std::format("W: redundant imports in translation unit {}:\n", nameOf(from)));
+                for (; (it != bySource.end()) && (std::get< 0 >(*it) == source) && (std::get< 1 >(*it) == from); ++it)
+                {
+                    const auto& current = *std::get< 2 >(*it);
+                    std::cout << std::format("   -> {} (already imported through {})\n", nameOf(current.to),
+                                             nameOf(current.through));
+                }
             }
+        }
+
+        //! What has to be rebuilt if some modules change. See @ref impact.
+        struct Impact
+        {
+            //! The changed modules that are part of the graph
+            std::vector< ModuleId > modules;
+            //! The changed modules that are not part of the graph
+            std::vector< std::string > unknown;
+            //! The modules that require any of the changed modules, directly or not. Sorted by name.
+            std::vector< ModuleId > dependents;
+            //! The compilation outputs that have to be rebuilt: those of the changed modules and of all units that
+            //! require any of the affected modules, consumers included. Sorted.
+            std::vector< std::string_view > units;
+        };
 
-            // Report SCCs
-            for (const auto& [i, scc] : m_sccs | std::views::enumerate)
+        /**
+         * Find what has to be rebuilt if the given modules change. Uses the reachability index, hence it takes time
+         * linear in the size of the result.
+         *
+         * @throw std::logic_error If the graph was made without @ref LoadOptions::reachability.
+         *
+         * @param modules The names of the changed modules
+         *
+         * @return The modules and compilation outputs that have to be rebuilt
+         */
+        [[nodiscard]] Impact impact(std::span< const std::string_view > modules) const
+        {
+            if (!m_reachability)
             {
-                std::cout << std::format(
-                    "E: Circular dependency:\n   -> Strongly connected components: {}\n   -> Shortest cycle: {}\n",
-                    scc | std::views::transform([&](const auto& id) { return m_graph.get_vertex(id).name; }) |
-                        std::views::join_with(std::string(", ")) | std::ranges::to< std::string >(),
-                    m_cycles.at(static_cast< std::size_t >(i)) |
-                        std::views::transform([&](const auto& id) { return m_graph.get_vertex(id).name; }) |
-                        std::views::join_with(std::string(" -> ")) | std::ranges::to< std::string >());
+                throw std::logic_error("The graph was made without reachability index.");
+            }
 
-                numErrors++;
+            Impact result;
+            std::vector< VertexId > changed;
+            for (auto name : modules)
+            {
+                auto id = m_symbols->modules.find(name);
+                if (!id || (*id >= m_vertexOf.size()) || !m_vertexOf[*id])
+                {
+                    result.unknown.emplace_back(name);
+                    continue;
+                }
+                changed.push_back(*m_vertexOf[*id]);
+                result.modules.push_back(*id);
             }
 
-            std::cout << std::format("{}Warnings: {}, Errors: {}\n", (numWarnings + numErrors > 0) ? "\n" : "",
-                                     numWarnings, numErrors);
+            // Modules in an SCC reach themselves. Changed ones are not listed as dependents.
+            auto affected = m_reachability->reaching(changed);
+            std::vector< PathId > units;
+            for (auto vertexId : affected)
+            {
+                if (!std::ranges::contains(changed, vertexId))
+                {
+                    result.dependents.push_back(m_modules[vertexId].name);
+                }
+            }
+            for (auto vertexId : changed)
+            {
+                const auto& outputs = m_modules[vertexId].outputs;
+                units.insert(units.end(), outputs.begin(), outputs.end());
+                affected.push_back(vertexId);
+            }
+            for (auto vertexId : affected)
+            {
+                const auto& requiredBy = m_modules[vertexId].requiredBy;
+                units.insert(units.end(), requiredBy.begin(), requiredBy.end());
+                for (auto consumer : m_consumerGraph.predecessors(vertexId))
+                {
+                    units.push_back(m_consumers[consumer - m_modules.size()]);
+                }
+            }
+            std::ranges::sort(units);
+            auto duplicates = std::ranges::unique(units);
+            units.erase(duplicates.begin(), duplicates.end());
+
+            result.units = units | std::views::transform([&](PathId id) { return m_symbols->paths.view(id); }) |
+                           std::ranges::to< std::vector >();
+            std::ranges::sort(result.units);
+            std::ranges::sort(result.dependents, {}, [&](ModuleId id) { return m_symbols->modules.view(id); });
+            return result;
         }
 
         /**
-         * Export the graph as DOT file.
+         * Prints the result of @ref impact.
+         *
+         * @param impact The impact of a change
+         */
+        void printImpact(const Impact& impact) const
+        {
+            auto join = [](const auto& names)
+            { return names | std::views::join_with(std::string_view(", ")) | std::ranges::to< std::string >(); };
+            auto moduleNames = [&](const std::vector< ModuleId >& ids)
+            { return join(ids | std::views::transform([&](ModuleId id) { return m_symbols->modules.view(id); })); };
+
+            for (const auto& name : impact.unknown)
+            {
+                std::cerr << std::format("W: Unknown module \"{}\"\n", name);
+            }
+            if (impact.modules.empty())
+            {
+                return;
+            }
+
+            std::cout << std::format("Impact of changing {}: {} module(s), {} compilation unit(s)\n",
+                                     moduleNames(impact.modules), impact.dependents.size(), impact.units.size());
+            if (!impact.dependents.empty())
+            {
+                std::cout << std::format("   -> Modules: {}\n", moduleNames(impact.dependents));
+            }
+            if (!impact.units.empty())
+            {
+                std::cout << std::format("   -> Compilation units: {}\n", join(impact.units));
+            }
+        }
+
+        /**
+         * Export the graph as DOT file. Consumers are left out, there are too many of them in a typical build.
+         *
+         * Large graphs take Graphviz ages to lay out. Depending on the options, modules are merged into fewer nodes
+         * by their names, see @ref groupNodes. Modules in an SCC always keep a node of their own, so the edges of
+         * circular dependencies stay visible. Edges between merged nodes are merged as well and labeled with the
+         * number of imports they stand for.
+         *
+         * @throw std::runtime_error If the file cannot be written.
          *
          * @param file The file to write to
+         * @param options How much detail to export
          */
-        void exportDOT(const std::filesystem::path& file)
+        void exportDOT(const std::filesystem::path& file, const DotOptions& options = {}) const
         {
-            graaf::io::to_dot(
-                m_graph, file,
-                // Node writer
-                [&]([[maybe_unused]] graaf::vertex_id_t vertexId, const ModuleInfo& moduleInfo)
+            std::vector< std::string_view > names(m_modules.size());
+            std::vector< bool > pinned(m_modules.size());
+            for (VertexId vertexId = 0; vertexId < m_modules.size(); ++vertexId)
+            {
+                names[vertexId] = nameOf(vertexId);
+                pinned[vertexId] = m_metrics[vertexId].isSCC();
+            }
+            auto nodes = groupNodes(names, pinned, options);
+            const auto& groupOf = nodes.groupOf;
+
+            // The edges between nodes. Edges within a merged node are left out.
+            std::vector< GraphEdge > edges;
+            edges.reserve(m_graph.numEdges());
+            for (const auto& [pid, rid] : m_graph.edges())
+            {
+                if (groupOf[pid] != groupOf[rid])
+                {
+                    edges.emplace_back(groupOf[pid], groupOf[rid]);
+                }
+            }
+            std::ranges::sort(edges);
+
+            std::vector< std::uint32_t > numIn(nodes.groups.size(), 0);
+            std::vector< std::uint32_t > numOut(nodes.groups.size(), 0);
+            for (auto it = edges.begin(); it != edges.end(); it = std::ranges::upper_bound(edges, *it))
+            {
+                numOut[it->first]++;
+                numIn[it->second]++;
+            }
+
+            BufferedWriter writer(file);
+            writer.print("digraph {{\n");
+            if (nodes.detail.mergePartitions || (nodes.detail.prefixDepth != 0))
+            {
+                writer.print("\tlabel=\"{} nodes for {} modules, {}\";\n\tlabelloc=t;\n", nodes.groups.size(),
+                             m_modules.size(), toString(nodes.detail));
+            }
+
+            for (const auto& [node, group] : nodes.groups | std::views::enumerate)
+            {
+                // A single module is shown as is, even if it stands for a prefix.
+                if (group.members.size() == 1)
                 {
-                    const auto& metrics = m_metrics.at(vertexId);
+                    const auto& metrics = m_metrics[group.members.front()];
 
                     constexpr auto flagFormat = "<b>&lt;{}&gt;</b>";
                     auto flag = metrics.isMissing ? std::format(flagFormat, "missing source") : "";
@@ -289,51 +855,584 @@ namespace mgt
                                         : metrics.isSource       ? "lightskyblue"
                                                                  : "lightgrey";
 
-                    return std::format(
-                        "label=<{}<br/>{}>, fontname=Monospace, shape=box, style=\"rounded,filled\", fillcolor={}",
-                        moduleInfo.name, flag, color);
-                },
-                // Edge writer
-                [&]([[maybe_unused]] const graaf::edge_id_t& edgeId, [[maybe_unused]] const Edge& edge) -> std::string
+                    writer.print("\t{} [label=<{}<br/>{}>, fontname=Monospace, shape=box, style=\"rounded,filled\", "
+                                 "fillcolor={}];\n",
+                                 node, nameOf(group.members.front()), flag, color);
+                    continue;
+                }
+
+                // Merged modules. Colored like a single one, by the edges of the merged node.
+                auto isMissing = std::ranges::all_of(group.members, [&](auto id) { return m_metrics[id].isMissing; });
+                auto in = numIn[static_cast< std::size_t >(node)];
+                auto out = numOut[static_cast< std::size_t >(node)];
+                const auto* color = isMissing            ? "orange"
+                                    : ((in + out) == 0) ? "tomato"
+                                    : (out == 0)        ? "mediumspringgreen"
+                                    : (in == 0)         ? "lightskyblue"
+                                                        : "lightgrey";
+
+                writer.print("\t{} [label=<<b>{}</b><br/>{} modules>, fontname=Monospace, shape=folder, "
+                             "style=filled, fillcolor={}];\n",
+                             node, group.label, group.members.size(), color);
+            }
+
+            for (auto it = edges.begin(); it != edges.end();)
+            {
+                auto next = std::ranges::upper_bound(edges, *it);
+                auto [from, to] = *it;
+                auto count = next - it;
+                it = next;
+
+                // Only single modules can be part of an SCC. Their edges are exported in full detail.
+                const auto& groupFrom = nodes.groups[from];
+                const auto& groupTo = nodes.groups[to];
+                if ((groupFrom.members.size() == 1) && (groupTo.members.size() == 1))
                 {
-                    auto [pid, rid] = edgeId;
-                    const auto& metricsP = m_metrics.at(pid);
-                    const auto& metricsR = m_metrics.at(rid);
+                    const auto& metricsP = m_metrics[groupFrom.members.front()];
+                    const auto& metricsR = m_metrics[groupTo.members.front()];
 
-                    // If both nodes are part of an SCC, the edge is part of that SCC
-                    bool isSCC = metricsR.isSCC && metricsP.isSCC;
+                    // If both nodes are part of the same SCC, the edge is part of that SCC
+                    bool isSCC = metricsP.isSCC() && (metricsP.scc == metricsR.scc);
                     bool isCycle = metricsR.isInShortestCycle & metricsP.isInShortestCycle;
 
                     const auto* color = isSCC ? "crimson" : "gray";
                     const auto* style = isCycle ? "dashed" : "solid";
                     auto width = 1 + (isSCC ? 2 : 0) + (isCycle ? 2 : 0);
 
-                    return std::format("style={}, penwidth={}, color={}, fontcolor=gray", style, width, color);
-                });
+                    writer.print("\t{} -> {} [style={}, penwidth={}, color={}, fontcolor=gray];\n", from, to, style,
+                                 width, color);
+                    continue;
+                }
+
+                writer.print("\t{} -> {} [style=solid, penwidth=1, color=gray, fontcolor=gray{}];\n", from, to,
+                             (count > 1) ? std::format(", label={}", count) : "");
+            }
+
+            writer.print("}}\n");
+            writer.close();
+        }
+
+        /**
+         * Write a snapshot of the graph, to be compared with the snapshot of another build. See @ref Snapshot. The
+         * consumers are not part of it, but they count as importers of the modules.
+         *
+         * @throw std::runtime_error If the file cannot be written.
+         *
+         * @param file The file to write to
+         */
+        void saveSnapshot(const std::filesystem::path& file) const
+        {
+            std::vector< std::string_view > names(m_modules.size());
+            std::vector< std::uint32_t > numIn(m_modules.size());
+            std::vector< std::uint32_t > flags(m_modules.size());
+            for (VertexId vertexId = 0; vertexId < m_modules.size(); ++vertexId)
+            {
+                names[vertexId] = nameOf(vertexId);
+                numIn[vertexId] = m_metrics[vertexId].numIn;
+                flags[vertexId] = (m_metrics[vertexId].isMissing ? Snapshot::missing : 0U) |
+                                  ((m_modules[vertexId].providedBy.size() > 1) ? Snapshot::multipleProviders : 0U);
+            }
+            Snapshot::save(file, names, m_graph, m_sccs, numIn, flags);
         }
 
     private:
-        //! The module graph is a simple di-graph that stores some extended info per module node.
-        using ModuleGraphImplT = graaf::directed_graph< ModuleInfo, Edge >;
+        //! The interned module names and paths that are referenced by the graph. Kept on the heap, as the symbol tables
+        //! are not movable.
+        std::shared_ptr< Symbols > m_symbols = std::make_shared< Symbols >();
 
-        //! The module requirements graph as constructed from DDI
-        ModuleGraphImplT m_graph;
+        //! The info per module node, indexed by vertex ID.
+        std::vector< ModuleInfo > m_modules;
+
+        //! The module requirements graph as constructed from DDI. Frozen once all DDI are added.
+        CSRGraph m_graph;
+
+        //! The compilation outputs of the consumers: translation units that import modules, but do not provide one.
+        //! Interned in @ref Symbols::paths. Kept out of m_modules, there are many more of them than modules.
+        std::vector< PathId > m_consumers;
+
+        //! The imports of the consumers. Vertex i < numModules() is module i, vertex numModules() + i is consumer i.
+        //! Edges only lead from consumers to modules.
+        CSRGraph m_consumerGraph;
+
+        //! If true, consumers are part of the graph. See @ref LoadOptions::consumers.
+        bool m_withConsumers = true;
+
+        //! The sources that declare each edge, as (from, to, source). Sorted. Interned in @ref Symbols::paths.
+        std::vector< std::tuple< VertexId, VertexId, PathId > > m_edgeSources;
 
         //! The strongly connected components (excluding single nodes)
-        graaf::algorithm::sccs_t m_sccs;
+        SCCs m_sccs;
 
         //! List of node IDs
-        using NodeList = std::list< graaf::vertex_id_t >;
+        using NodeList = std::vector< VertexId >;
+
+        //! The shortest cycles per SCC, same order as m_sccs. Each cycle is a list of ids, the first one is repeated at
+        //! the end. The first cycle is (one of) the shortest cycle of the SCC.
+        std::vector< std::vector< NodeList > > m_cycles;
+
+        //! Index of the modules that require each module, directly or not. Only built if requested.
+        std::optional< ReachabilityIndex > m_reachability;
+
+        //! If true, the reachability index is built. See @ref LoadOptions::reachability.
+        bool m_withReachability = false;
+
+        //! The number of threads to use for the analysis
+        unsigned m_jobs = 1;
+
+        //! The max. number of cycles to find per SCC
+        std::size_t m_cyclesPerSCC = 1;
+
+        //! A set of per-node metrics that have been derived from the graph. Indexed by vertex ID.
+        std::vector< ModuleMetrics > m_metrics;
+
+        //! The DDI the graph was built from.
+        std::vector< ddi::DDI > m_ddis;
+
+        //! Maps a module ID to its vertex. Module IDs are dense, so a plain vector is enough.
+        std::vector< std::optional< VertexId > > m_vertexOf;
+
+        //! Cache statistics of the DDI loading
+        struct CacheStats
+        {
+            std::size_t hits = 0;
+            std::size_t misses = 0;
+        };
 
-        //! A list of cycles. Each cycle is a list of ids. Always (one of) the shortest cycle per SCC.
-        std::vector< NodeList > m_cycles;
+        //! The cache statistics. Only set if a cache was used.
+        std::optional< CacheStats > m_cacheStats;
 
-        //! A set of per-node metrics that have been derived from the graph.
-        std::unordered_map< graaf::vertex_id_t, ModuleMetrics > m_metrics;
+        //! How long it took to find and load the DDI files. Only set if the graph loaded them itself.
+        std::optional< ddi::LoadTimes > m_loadTimes;
 
         //! The path from where the DDI files have been loaded.
         std::filesystem::path m_path;
 
+        /**
+         * Where a module is mentioned in the DDI: the index of the DDI in the upper 32 bits, plus 1, and the number of
+         * modules mentioned before it in that DDI in the lower ones. Orders the mentions like a walk over the DDI in
+         * order would. 0 means never mentioned.
+         */
+        using Mention = std::uint64_t;
+
+        //! A path belonging to a module, like one of its sources, and where it was mentioned.
+        struct ModulePath
+        {
+            //! A ModuleId while collecting, the VertexId afterwards
+            std::uint32_t module = 0;
+            PathId path = 0;
+            Mention mention = 0;
+        };
+
+        //! What a thread collects in @ref build
+        struct BuildBuffer
+        {
+            //! (from, to, source) of each import of a module
+            std::vector< std::tuple< VertexId, VertexId, PathId > > edges;
+            //! The imports of the consumers
+            std::vector< GraphEdge > consumerEdges;
+            std::vector< ModulePath > providedBy;
+            std::vector< ModulePath > requiredBy;
+            std::vector< ModulePath > outputs;
+        };
+
+        /**
+         * Transform the DDI info to a graph. This allows for easy application of graph algorithms to find issues
+         * hidden within.
+         *
+         * The DDI are split among the threads. Each thread collects the imports and the sources, outputs and importers
+         * of the modules into buffers of its own. The buffers are merged with a parallel sort, which also removes the
+         * duplicates, and frozen into the graph. Vertices are numbered in the order their modules are first mentioned
+         * in the DDI, so the graph is the same for any number of threads.
+         *
+         * @param ddis The DDI to build the graph from.
+         */
+        void build(std::span< const ddi::DDI > ddis)
+        {
+            auto numJobs = std::max(1U, m_jobs);
+
+            // The consumers are numbered in the order of the DDI.
+            std::vector< VertexId > firstConsumer(ddis.size() + 1, 0);
+            for (std::size_t i = 0; i < ddis.size(); ++i)
+            {
+                auto numConsumers = m_withConsumers ? std::ranges::count_if(ddis[i].rules, [](const auto& rule)
+                                                                            { return rule.provides.empty(); })
+                                                    : 0;
+                firstConsumer[i + 1] = firstConsumer[i] + static_cast< VertexId >(numConsumers);
+            }
+            m_consumers.resize(firstConsumer.back());
+
+            std::vector< std::atomic< Mention > > firstMention(m_symbols->modules.size());
+            std::vector< BuildBuffer > buffers(numJobs);
+            {
+                const ScopedTimer timer("collect");
+                parallelFor(ddis.size(), numJobs,
+                            [&](std::size_t i, unsigned worker)
+                            { collect(ddis[i], i, firstConsumer[i], firstMention, buffers[worker]); });
+            }
+
+            const ScopedTimer timer("freeze");
+
+            // Number the vertices
+            std::vector< std::pair< Mention, ModuleId > > mentioned;
+            for (ModuleId module = 0; module < firstMention.size(); ++module)
+            {
+                if (auto mention = firstMention[module].load(std::memory_order_relaxed); mention != 0)
+                {
+                    mentioned.emplace_back(mention, module);
+                }
+            }
+            std::ranges::sort(mentioned);
+
+            m_vertexOf.assign(firstMention.size(), std::nullopt);
+            m_modules.resize(mentioned.size());
+            for (VertexId vertexId = 0; vertexId < mentioned.size(); ++vertexId)
+            {
+                m_modules[vertexId].name = mentioned[vertexId].second;
+                m_vertexOf[mentioned[vertexId].second] = vertexId;
+            }
+
+            auto numModules = static_cast< VertexId >(m_modules.size());
+            parallelFor(buffers.size(), numJobs,
+                        [&](std::size_t i, unsigned)
+                        {
+                            auto& buffer = buffers[i];
+                            for (auto& [from, to, source] : buffer.edges)
+                            {
+                                from = *m_vertexOf[from];
+                                to = *m_vertexOf[to];
+                            }
+                            // The consumers come after all modules.
+                            for (auto& [consumer, to] : buffer.consumerEdges)
+                            {
+                                consumer += numModules;
+                                to = *m_vertexOf[to];
+                            }
+                            for (auto* paths : {&buffer.providedBy, &buffer.requiredBy, &buffer.outputs})
+                            {
+                                for (auto& entry : *paths)
+                                {
+                                    entry.module = *m_vertexOf[entry.module];
+                                }
+                            }
+                        });
+
+            // Take one kind of buffer of all threads
+            auto take = [&](auto member)
+            {
+                std::vector< std::remove_reference_t< decltype(buffers.front().*member) > > result;
+                for (auto& buffer : buffers)
+                {
+                    result.push_back(std::move(buffer.*member));
+                }
+                return result;
+            };
+
+            // Sorted by from and to first, so the edges are sorted too. Duplicates, like those of a module that is
+            // provided twice, are removed here and by the graph.
+            m_edgeSources = parallelSort(take(&BuildBuffer::edges), numJobs);
+            auto duplicates = std::ranges::unique(m_edgeSources);
+            m_edgeSources.erase(duplicates.begin(), duplicates.end());
+
+            std::vector< GraphEdge > edges;
+            edges.reserve(m_edgeSources.size());
+            for (const auto& [from, to, source] : m_edgeSources)
+            {
+                if (edges.empty() || (edges.back() != GraphEdge(from, to)))
+                {
+                    edges.emplace_back(from, to);
+                }
+            }
+            m_graph = CSRGraph(m_modules.size(), std::move(edges));
+            auto consumerEdges = parallelSort(take(&BuildBuffer::consumerEdges), numJobs);
+            m_consumerGraph = CSRGraph(m_modules.size() + m_consumers.size(), std::move(consumerEdges));
+
+            fillPaths(take(&BuildBuffer::providedBy), &ModuleInfo::providedBy, numJobs);
+            fillPaths(take(&BuildBuffer::requiredBy), &ModuleInfo::requiredBy, numJobs);
+            fillPaths(take(&BuildBuffer::outputs), &ModuleInfo::outputs, numJobs);
+        }
+
+        /**
+         * Collect the rules of one DDI. See @ref build.
+         *
+         * @param ddi The DDI
+         * @param index The index of the DDI
+         * @param consumer The number of the first consumer of the DDI
+         * @param firstMention Receives the first mention of each module
+         * @param buffer Receives the rest
+         */
+        void collect(const ddi::DDI& ddi, std::size_t index, VertexId consumer,
+                     std::vector< std::atomic< Mention > >& firstMention, BuildBuffer& buffer)
+        {
+            auto next = Mention{index + 1} << 32U;
+            auto mention = [&](ModuleId module)
+            {
+                auto current = next++;
+                auto& first = firstMention[module];
+                auto seen = first.load(std::memory_order_relaxed);
+                while (((seen == 0) || (current < seen)) &&
+                       !first.compare_exchange_weak(seen, current, std::memory_order_relaxed))
+                {
+                }
+                return current;
+            };
+
+            for (const auto& rule : ddi.rules)
+            {
+                // A consumer only refers to the modules it requires. The consumer itself is not a module node.
+                if (rule.provides.empty() && m_withConsumers)
+                {
+                    m_consumers[consumer] = rule.primaryOutput;
+                    for (const auto& req : rule.requires_)
+                    {
+                        mention(req.logicalName);
+                        buffer.consumerEdges.emplace_back(consumer, req.logicalName);
+                    }
+                    consumer++;
+                }
+
+                for (const auto& provide : rule.provides)
+                {
+                    auto provided = mention(provide.logicalName);
+                    buffer.providedBy.push_back(
+                        {.module = provide.logicalName, .path = provide.sourcePath, .mention = provided});
+                    buffer.outputs.push_back(
+                        {.module = provide.logicalName, .path = rule.primaryOutput, .mention = provided});
+
+                    for (const auto& req : rule.requires_)
+                    {
+                        auto required = mention(req.logicalName);
+                        buffer.requiredBy.push_back(
+                            {.module = req.logicalName, .path = rule.primaryOutput, .mention = required});
+
+                        // As this is a requirement-graph, the arrows point towards the required component.
+                        buffer.edges.emplace_back(provide.logicalName, req.logicalName, provide.sourcePath);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Fill a list of paths of each module, without duplicates, in the order the paths were mentioned first.
+         *
+         * @param parts The paths of the modules, collected by the threads.
+         * @param list The list to fill
+         * @param jobs The number of threads to use
+         */
+        void fillPaths(std::vector< std::vector< ModulePath > > parts, std::vector< PathId > ModuleInfo::* list,
+                       unsigned jobs)
+        {
+            auto byPath = [](const ModulePath& lhs, const ModulePath& rhs)
+            { return std::tie(lhs.module, lhs.path, lhs.mention) < std::tie(rhs.module, rhs.path, rhs.mention); };
+            auto paths = parallelSort(std::move(parts), jobs, byPath);
+
+            // Keep the first mention of each path
+            auto duplicates = std::ranges::unique(paths, [](const ModulePath& lhs, const ModulePath& rhs)
+                                                  { return (lhs.module == rhs.module) && (lhs.path == rhs.path); });
+            paths.erase(duplicates.begin(), duplicates.end());
+
+            std::vector< std::size_t > offsets(m_modules.size() + 1, 0);
+            for (const auto& entry : paths)
+            {
+                offsets[entry.module + 1]++;
+            }
+            for (std::size_t i = 1; i < offsets.size(); ++i)
+            {
+                offsets[i] += offsets[i - 1];
+            }
+
+            parallelFor(m_modules.size(), jobs,
+                        [&](std::size_t vertexId, unsigned)
+                        {
+                            auto modulePaths = std::span(paths).subspan(offsets[vertexId],
+                                                                        offsets[vertexId + 1] - offsets[vertexId]);
+                            std::ranges::sort(modulePaths, {}, &ModulePath::mention);
+                            auto& result = m_modules[vertexId].*list;
+                            result.clear();
+                            for (const auto& entry : modulePaths)
+                            {
+                                result.push_back(entry.path);
+                            }
+                        });
+        }
+
+        //! Find the SCCs and the shortest cycle in each of them.
+        void analyze()
+        {
+            // The strongest connected components indicate cycles in the requirement-graph.
+            {
+                const ScopedTimer timer("analysis: SCCs");
+                m_sccs = stronglyConnectedComponents(m_graph, {.minSize = 2, .jobs = m_jobs});
+            }
+
+            // Using the SCC, calculate the shortest cycles in each SCC.
+            const ScopedTimer timer("analysis: cycles");
+            m_cycles = findShortestCycles(
+                m_graph.numVertices(), m_sccs, [&](VertexId id) { return m_graph.successors(id); },
+                {.maxCycles = m_cyclesPerSCC, .jobs = m_jobs});
+        }
+
+        //! For each node, calculate some metrics. They only make sense in relation to the graph the node is in.
+        void computeMetrics()
+        {
+            const ScopedTimer timer("metrics");
+            m_metrics.assign(m_modules.size(), {});
+            for (VertexId vertexId = 0; vertexId < m_modules.size(); ++vertexId)
+            {
+                auto numIn = static_cast< std::uint32_t >(m_graph.inDegree(vertexId) +
+                                                          m_consumerGraph.inDegree(vertexId));
+                auto numOut = static_cast< std::uint32_t >(m_graph.outDegree(vertexId));
+
+                auto& metrics = m_metrics[vertexId];
+                metrics.numIn = numIn;
+                metrics.numOut = numOut;
+                metrics.isMissing = m_modules[vertexId].providedBy.empty();
+                metrics.isSource = (numIn == 0) && (numOut != 0);
+                metrics.isSink = (numIn != 0) && (numOut == 0);
+                metrics.isDisconnected = (numIn + numOut) == 0; // = isSource && isSink
+            }
+
+            // A single pass over the SCCs and their cycles. Every node is part of at most one SCC.
+            for (std::size_t i = 0; i < m_sccs.size(); ++i)
+            {
+                for (auto vertexId : m_sccs[i])
+                {
+                    m_metrics[vertexId].scc = static_cast< std::uint32_t >(i);
+                }
+                if (!m_cycles[i].empty())
+                {
+                    for (auto vertexId : m_cycles[i].front())
+                    {
+                        m_metrics[vertexId].isInShortestCycle = true;
+                    }
+                }
+            }
+        }
+
+        //! All edges of the graph in terms of module IDs, sorted.
+        [[nodiscard]] std::vector< ModuleEdge > moduleEdges() const
+        {
+            std::vector< ModuleEdge > edges;
+            edges.reserve(m_graph.numEdges());
+            for (const auto& [from, to] : m_graph.edges())
+            {
+                edges.emplace_back(m_modules[from].name, m_modules[to].name);
+            }
+            std::ranges::sort(edges);
+            return edges;
+        }
+
+        /**
+         * The analysis results in terms of module IDs. Used for caching.
+         *
+         * @param edges The result of @ref moduleEdges
+         */
+        [[nodiscard]] AnalysisCache::Analysis analysis(std::vector< ModuleEdge > edges) const
+        {
+            auto toModules = [&](const auto& nodes)
+            {
+                return nodes | std::views::transform([&](const auto& id) { return m_modules[id].name; }) |
+                       std::ranges::to< std::vector >();
+            };
+
+            auto toModuleLists = [&](const auto& lists)
+            { return lists | std::views::transform(toModules) | std::ranges::to< std::vector >(); };
+
+            std::optional< ReachabilityIndex > reachability;
+            if (m_reachability)
+            {
+                reachability = m_reachability->relabel([&](VertexId id) { return m_modules[id].name; });
+            }
+
+            return {.edges = std::move(edges),
+                    .cyclesPerSCC = m_cyclesPerSCC,
+                    .sccs = toModuleLists(m_sccs),
+                    .cycles = m_cycles | std::views::transform(toModuleLists) | std::ranges::to< std::vector >(),
+                    .reachability = std::move(reachability)};
+        }
+
+        /**
+         * Use the analysis results of a previous run instead of calling @ref analyze.
+         *
+         * @param analysis The analysis. Must have been made for the same edges.
+         */
+        void restore(const AnalysisCache::Analysis& analysis)
+        {
+            auto toVertex = [&](ModuleId id) { return m_vertexOf.at(id).value(); };
+            for (const auto& scc : analysis.sccs)
+            {
+                m_sccs.push_back(scc | std::views::transform(toVertex) | std::ranges::to< std::vector >());
+            }
+            for (const auto& cycles : analysis.cycles)
+            {
+                auto& restored = m_cycles.emplace_back();
+                for (const auto& cycle : cycles)
+                {
+                    restored.push_back(cycle | std::views::transform(toVertex) | std::ranges::to< NodeList >());
+                }
+            }
+
+            // The edges do not cover modules without any. The index has to cover exactly the current modules.
+            const auto& index = analysis.reachability;
+            auto isKnown = [&](ModuleId id) { return (id < m_vertexOf.size()) && m_vertexOf[id].has_value(); };
+            if (m_withReachability && index && (index->size() == m_modules.size()) &&
+                std::ranges::all_of(index->order(), isKnown))
+            {
+                m_reachability = index->relabel(toVertex);
+            }
+        }
+
+        //! Build the reachability index, if requested and not restored already.
+        void indexReachability()
+        {
+            if (m_withReachability && !m_reachability)
+            {
+                const ScopedTimer timer("reachability index");
+                m_reachability = ReachabilityIndex::make(Condensation::make(m_graph, m_sccs));
+            }
+        }
+
+        //! Add the size of the graph and its SCCs to the profile. See @ref Profile.
+        void countProfile() const
+        {
+            auto& counters = profile();
+            if (!counters.isEnabled())
+            {
+                return;
+            }
+
+            counters.count("graphs", 1);
+            counters.count("graph.modules", m_modules.size());
+            counters.count("graph.consumers", m_consumers.size());
+            counters.count("graph.edges", m_graph.numEdges() + m_consumerGraph.numEdges());
+            counters.count("sccs", m_sccs.size());
+            for (const auto& scc : m_sccs)
+            {
+                counters.count("sccs.modules", scc.size());
+                counters.maximum("sccs.largest", scc.size());
+            }
+        }
+
+        //! The name of the module represented by the given vertex. For consumers, the compilation output.
+        [[nodiscard]] std::string_view nameOf(VertexId vertexId) const
+        {
+            return (vertexId < m_modules.size()) ? m_symbols->modules.view(m_modules[vertexId].name)
+                                                 : m_symbols->paths.view(m_consumers[vertexId - m_modules.size()]);
+        }
+
+        //! The graph of the modules plus the consumers. Consumers are the vertices after the modules.
+        [[nodiscard]] CSRGraph withConsumers() const
+        {
+            if (m_consumers.empty())
+            {
+                return m_graph;
+            }
+
+            auto edges = m_graph.edges();
+            auto consumerEdges = m_consumerGraph.edges();
+            edges.insert(edges.end(), consumerEdges.begin(), consumerEdges.end());
+            return {m_consumerGraph.numVertices(), std::move(edges)};
+        }
+
         //! Not very useful constructor. Values are calculated and filled by @ref make
         explicit ModuleGraph(std::filesystem::path path) : m_path(std::move(path))
         {
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mgt
+{
+    /**
+     * Find the .ninja_log of the build a directory belongs to. Ninja keeps it in the build directory, which is the
+     * directory itself or one of its parents.
+     *
+     * @param directory The directory to start in, e.g. a target directory.
+     *
+     * @return The log file or std::nullopt if there is none.
+     */
+    [[nodiscard]] inline std::optional< std::filesystem::path > findNinjaLog(const std::filesystem::path& directory)
+    {
+        for (auto current = std::filesystem::absolute(directory).lexically_normal(); current.has_relative_path();
+             current = current.parent_path())
+        {
+            if (std::filesystem::is_regular_file(current / ".ninja_log"))
+            {
+                return current / ".ninja_log";
+            }
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * Read the build times from a .ninja_log file (format version 5 or later). Each line is
+     * "start \t end \t mtime \t output \t hash", start and end are in milliseconds. Ninja appends to the log, so for
+     * outputs that appear more than once, the last entry wins.
+     *
+     * @throw std::runtime_error If the file cannot be read.
+     *
+     * @param file The log file
+     *
+     * @return The build time in milliseconds per output. The outputs are spelled like Ninja knows them, usually
+     * relative to the build directory, normalized and with forward slashes.
+     */
+    [[nodiscard]] inline std::unordered_map< std::string, double > readNinjaLog(const std::filesystem::path& file)
+    {
+        std::unordered_map< std::string, double > result;
+
+        const MappedFile mapped(file);
+        for (auto line : mapped.view() | std::views::split('\n'))
+        {
+            std::string_view text(line);
+            if (text.empty() || text.starts_with('#'))
+            {
+                continue;
+            }
+
+            std::vector< std::string_view > fields;
+            for (auto field : text | std::views::split('\t'))
+            {
+                fields.emplace_back(field);
+            }
+            if (fields.size() < 4)
+            {
+                continue;
+            }
+
+            std::int64_t start = 0;
+            std::int64_t end = 0;
+            auto parse = [](std::string_view field, std::int64_t& value)
+            {
+                auto [ptr, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+                return (error == std::errc{}) && (ptr == field.data() + field.size()); // NOLINT: pointer arithmetic.
+            };
+            if (!parse(fields[0], start) || !parse(fields[1], end) || (end < start))
+            {
+                continue;
+            }
+
+            result.insert_or_assign(std::filesystem::path(fields[3]).lexically_normal().generic_string(),
+                                    static_cast< double >(end - start));
+        }
+
+        return result;
+    }
+} // namespace mgt
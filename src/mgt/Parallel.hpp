@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    /**
+     * The number of worker threads to use by default.
+     *
+     * @return The number of hardware threads, at least 1.
+     */
+    [[nodiscard]] inline unsigned defaultJobs()
+    {
+        return std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    /**
+     * A simple multi-producer, multi-consumer FIFO queue. Consumers block until work is available or the queue gets
+     * closed.
+     *
+     * @tparam T The type of work item
+     */
+    template < typename T >
+    class WorkQueue
+    {
+    public:
+        /**
+         * Add a work item and wake up a waiting consumer.
+         *
+         * @param item The item to add
+         */
+        void push(T item)
+        {
+            {
+                std::scoped_lock lock(m_mutex);
+                m_items.push_back(std::move(item));
+            }
+            m_condition.notify_one();
+        }
+
+        /**
+         * Signal that no more items will be pushed. Consumers drain the remaining items and then stop.
+         */
+        void close()
+        {
+            {
+                std::scoped_lock lock(m_mutex);
+                m_closed = true;
+            }
+            m_condition.notify_all();
+        }
+
+        /**
+         * Take the next item. Blocks until an item is available.
+         *
+         * @return The item or std::nullopt if the queue is closed and empty.
+         */
+        [[nodiscard]] std::optional< T > pop()
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_closed || !m_items.empty(); });
+
+            if (m_items.empty())
+            {
+                return std::nullopt;
+            }
+
+            auto item = std::move(m_items.front());
+            m_items.pop_front();
+            return item;
+        }
+
+    private:
+        //! Guards all members
+        std::mutex m_mutex;
+
+        //! Signals new items or closing
+        std::condition_variable m_condition;
+
+        //! The pending items
+        std::deque< T > m_items;
+
+        //! No more items will be pushed if true
+        bool m_closed = false;
+    };
+
+    /**
+     * Call a function for each index in [0, count) using multiple threads. Indices are handed out dynamically, so
+     * uneven workloads balance out. The call blocks until all indices are processed.
+     *
+     * @param count The number of indices
+     * @param jobs The max. number of threads to use. With 1 or less, everything runs on the calling thread.
+     * @param func The function to call. Gets the index and the number of the worker thread [0, jobs).
+     */
+    template < typename Func >
+    void parallelFor(std::size_t count, unsigned jobs, Func&& func)
+    {
+        auto numWorkers = std::min< std::size_t >(std::max(1U, jobs), count);
+        if (numWorkers <= 1)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                func(i, 0U);
+            }
+            return;
+        }
+
+        std::atomic< std::size_t > next = 0;
+        std::vector< std::jthread > workers;
+        workers.reserve(numWorkers);
+        for (std::size_t worker = 0; worker < numWorkers; ++worker)
+        {
+            workers.emplace_back(
+                [&, worker]
+                {
+                    for (auto i = next++; i < count; i = next++)
+                    {
+                        func(i, static_cast< unsigned >(worker));
+                    }
+                });
+        }
+    }
+
+    /**
+     * Sort items that were collected in parts, like one part per thread, into one vector. The parts are sorted in
+     * parallel, then merged pairwise, again in parallel.
+     *
+     * @param parts The parts. Consumed.
+     * @param jobs The max. number of threads to use
+     * @param compare The order of the items
+     *
+     * @return All items, sorted
+     */
+    template < typename T, typename Compare = std::ranges::less >
+    [[nodiscard]] std::vector< T > parallelSort(std::vector< std::vector< T > > parts, unsigned jobs,
+                                                Compare compare = {})
+    {
+        if (parts.empty())
+        {
+            return {};
+        }
+
+        parallelFor(parts.size(), jobs, [&](std::size_t i, unsigned) { std::ranges::sort(parts[i], compare); });
+        while (parts.size() > 1)
+        {
+            std::vector< std::vector< T > > merged((parts.size() + 1) / 2);
+            parallelFor(merged.size(), jobs,
+                        [&](std::size_t i, unsigned)
+                        {
+                            auto& lhs = parts[2 * i];
+                            if (2 * i + 1 == parts.size())
+                            {
+                                merged[i] = std::move(lhs);
+                                return;
+                            }
+
+                            auto& rhs = parts[2 * i + 1];
+                            merged[i].reserve(lhs.size() + rhs.size());
+                            std::ranges::merge(lhs, rhs, std::back_inserter(merged[i]), compare);
+                            lhs = {};
+                            rhs = {};
+                        });
+            parts = std::move(merged);
+        }
+        return std::move(parts.front());
+    }
+} // namespace mgt
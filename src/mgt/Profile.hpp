@@ -0,0 +1,348 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define MGT_HAVE_RUSAGE 1
+    #include <sys/resource.h>
+#endif
+
+namespace mgt
+{
+    namespace detail
+    {
+        // Plain atomics with constant initialization: the allocation hooks may run before any dynamic initialization.
+
+        //! True while profiling
+        inline constinit std::atomic< bool > isProfiling{false};
+        //! The number of allocations while profiling
+        inline constinit std::atomic< std::uint64_t > numAllocations{0};
+        //! The number of bytes allocated while profiling
+        inline constinit std::atomic< std::uint64_t > numAllocatedBytes{0};
+    } // namespace detail
+
+    /**
+     * Count an allocation, if profiling. Meant to be called by a replacement of the global operator new, which only
+     * the executable can provide.
+     *
+     * @param size The number of bytes allocated
+     */
+    inline void countAllocation(std::size_t size) noexcept
+    {
+        if (detail::isProfiling.load(std::memory_order_relaxed))
+        {
+            detail::numAllocations.fetch_add(1, std::memory_order_relaxed);
+            detail::numAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * The time spent per phase and some counters of a run, like the number of parsed bytes. Disabled by default.
+     * While disabled, recording costs a single atomic load. There is one instance per process, see @ref profile.
+     *
+     * Phases are timed with @ref ScopedTimer. Phases started while another one is running on the same thread are
+     * nested into that one. Phases and counters that occur several times, like one graph per target, are summed up.
+     * On worker threads, the times of the phases add up across the threads.
+     */
+    class Profile
+    {
+    public:
+        //! A timed phase
+        struct Phase
+        {
+            //! The name of the phase
+            std::string name;
+            //! The number of enclosing phases
+            std::size_t depth = 0;
+            //! How often the phase was run
+            std::size_t calls = 0;
+            //! The total time of all runs
+            std::chrono::duration< double, std::milli > time{};
+        };
+
+        //! A counter
+        struct Counter
+        {
+            //! The name of the counter
+            std::string name;
+            //! Its value
+            std::uint64_t value = 0;
+        };
+
+        //! Start recording.
+        void enable()
+        {
+            detail::isProfiling.store(true, std::memory_order_relaxed);
+        }
+
+        //! True if recording
+        [[nodiscard]] bool isEnabled() const
+        {
+            return detail::isProfiling.load(std::memory_order_relaxed);
+        }
+
+        //! Forget all phases and counters. Must not be called while a phase is running.
+        void reset()
+        {
+            const std::scoped_lock lock(m_mutex);
+            m_phases.clear();
+            m_counters.clear();
+        }
+
+        /**
+         * Add to a counter.
+         *
+         * @param name The counter. Created with 0 if it does not exist yet.
+         * @param value The value to add
+         */
+        void count(std::string_view name, std::uint64_t value)
+        {
+            if (isEnabled())
+            {
+                const std::scoped_lock lock(m_mutex);
+                counter(name).value += value;
+            }
+        }
+
+        /**
+         * Raise a counter to a value, if it is smaller.
+         *
+         * @param name The counter. Created with 0 if it does not exist yet.
+         * @param value The new max. value
+         */
+        void maximum(std::string_view name, std::uint64_t value)
+        {
+            if (isEnabled())
+            {
+                const std::scoped_lock lock(m_mutex);
+                auto& entry = counter(name);
+                entry.value = std::max(entry.value, value);
+            }
+        }
+
+        //! The phases in the order they were started first
+        [[nodiscard]] std::vector< Phase > phases() const
+        {
+            const std::scoped_lock lock(m_mutex);
+            return m_phases;
+        }
+
+        //! The counters in the order they were created, followed by the memory counters.
+        [[nodiscard]] std::vector< Counter > counters() const
+        {
+            std::vector< Counter > result;
+            {
+                const std::scoped_lock lock(m_mutex);
+                result = m_counters;
+            }
+
+            if (auto peak = peakMemory())
+            {
+                result.push_back({.name = "memory.peakResidentBytes", .value = *peak});
+            }
+            // Only counted if the executable hooks the global operator new. See @ref countAllocation.
+            if (auto allocations = detail::numAllocations.load(std::memory_order_relaxed); allocations > 0)
+            {
+                result.push_back({.name = "memory.allocations", .value = allocations});
+                result.push_back({.name = "memory.allocatedBytes",
+                                  .value = detail::numAllocatedBytes.load(std::memory_order_relaxed)});
+            }
+            return result;
+        }
+
+        /**
+         * Prints the phases and counters as a table.
+         *
+         * @param out Where to print to
+         */
+        void print(std::ostream& out = std::cout) const
+        {
+            out << "\nProfile:\n";
+            for (const auto& phase : phases())
+            {
+                auto name = std::string(phase.depth * 2, ' ') + phase.name;
+                out << std::format("   {:<40} {:>12.2f} ms{}\n", name, phase.time.count(),
+                                   (phase.calls > 1) ? std::format(" ({} calls)", phase.calls) : "");
+            }
+            for (const auto& [name, value] : counters())
+            {
+                out << std::format("   {:<40} {:>12}\n", name, value);
+            }
+        }
+
+        //! The phases and counters as JSON document.
+        [[nodiscard]] std::string toJSON() const
+        {
+            std::string result = "{\n  \"phases\": [";
+            auto out = std::back_inserter(result);
+            for (const auto& [i, phase] : phases() | std::views::enumerate)
+            {
+                std::format_to(out, "{}\n    {{\"name\": \"{}\", \"depth\": {}, \"calls\": {}, \"ms\": {:.3f}}}",
+                               (i == 0) ? "" : ",", escape(phase.name), phase.depth, phase.calls, phase.time.count());
+            }
+            result += "\n  ],\n  \"counters\": {";
+            for (const auto& [i, counter] : counters() | std::views::enumerate)
+            {
+                std::format_to(out, "{}\n    \"{}\": {}", (i == 0) ? "" : ",", escape(counter.name), counter.value);
+            }
+            result += "\n  }\n}\n";
+            return result;
+        }
+
+    private:
+        friend class ScopedTimer;
+
+        //! Protects the phases and counters
+        mutable std::mutex m_mutex;
+
+        //! The phases in the order they were started first
+        std::vector< Phase > m_phases;
+
+        //! The counters in the order they were created
+        std::vector< Counter > m_counters;
+
+        //! The counter of the given name. Creates it, if needed. The mutex must be held.
+        [[nodiscard]] Counter& counter(std::string_view name)
+        {
+            auto it = std::ranges::find(m_counters, name, &Counter::name);
+            if (it == m_counters.end())
+            {
+                m_counters.push_back({.name = std::string(name), .value = 0});
+                return m_counters.back();
+            }
+            return *it;
+        }
+
+        //! Start a phase. Returns its index, if recording.
+        [[nodiscard]] std::optional< std::size_t > beginPhase(std::string_view name)
+        {
+            if (!isEnabled())
+            {
+                return std::nullopt;
+            }
+
+            auto depth = runningPhases()++;
+            const std::scoped_lock lock(m_mutex);
+            auto it = std::ranges::find_if(m_phases, [&](const Phase& phase)
+                                           { return (phase.name == name) && (phase.depth == depth); });
+            if (it == m_phases.end())
+            {
+                m_phases.push_back({.name = std::string(name), .depth = depth, .calls = 0, .time = {}});
+                return m_phases.size() - 1;
+            }
+            return static_cast< std::size_t >(it - m_phases.begin());
+        }
+
+        //! End a phase started by @ref beginPhase.
+        void endPhase(std::size_t index, std::chrono::steady_clock::duration time)
+        {
+            runningPhases()--;
+            const std::scoped_lock lock(m_mutex);
+            m_phases[index].calls++;
+            m_phases[index].time += time;
+        }
+
+        //! The number of running phases of the calling thread
+        [[nodiscard]] static std::size_t& runningPhases()
+        {
+            static thread_local std::size_t depth = 0;
+            return depth;
+        }
+
+        //! The peak resident set size of the process in bytes, if available.
+        [[nodiscard]] static std::optional< std::uint64_t > peakMemory()
+        {
+#ifdef MGT_HAVE_RUSAGE
+            rusage usage{};
+            if (::getrusage(RUSAGE_SELF, &usage) != 0)
+            {
+                return std::nullopt;
+            }
+    #ifdef __APPLE__
+            return static_cast< std::uint64_t >(usage.ru_maxrss); // Bytes
+    #else
+            return static_cast< std::uint64_t >(usage.ru_maxrss) * 1024; // KiB
+    #endif
+#else
+            return std::nullopt;
+#endif
+        }
+
+        //! Escape a string for JSON. The names are plain identifiers, only quotes and backslashes are escaped.
+        [[nodiscard]] static std::string escape(std::string_view str)
+        {
+            std::string result;
+            for (auto c : str)
+            {
+                if ((c == '"') || (c == '\\'))
+                {
+                    result += '\\';
+                }
+                result += c;
+            }
+            return result;
+        }
+    };
+
+    //! The profile of this process
+    [[nodiscard]] inline Profile& profile()
+    {
+        static Profile instance;
+        return instance;
+    }
+
+    /**
+     * Times a phase from construction to destruction, if profiling. See @ref Profile.
+     */
+    class ScopedTimer
+    {
+    public:
+        /**
+         * Start the phase.
+         *
+         * @param phase The name of the phase. Phases of the same name and depth are summed up.
+         */
+        explicit ScopedTimer(std::string_view phase) : m_index(profile().beginPhase(phase))
+        {
+            if (m_index)
+            {
+                m_start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer(ScopedTimer&&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(ScopedTimer&&) = delete;
+
+        //! End the phase
+        ~ScopedTimer()
+        {
+            if (m_index)
+            {
+                profile().endPhase(*m_index, std::chrono::steady_clock::now() - m_start);
+            }
+        }
+
+    private:
+        //! The index of the phase in the profile, if profiling
+        std::optional< std::size_t > m_index;
+
+        //! When the phase started
+        std::chrono::steady_clock::time_point m_start;
+    };
+} // namespace mgt
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "Condensation.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    /**
+     * An index that answers "which vertices reach these vertices?" in time linear in the size of the answer. For the
+     * module graph, these are the modules that have to be rebuilt if a module changes.
+     *
+     * Each vertex gets a position. Positions are assigned by a depth-first search along the reversed edges of the
+     * condensation, in post-order, and the vertices of an SCC get consecutive positions. This way, the vertices
+     * reaching a vertex mostly have consecutive positions as well, like a subtree of the search does. The vertices
+     * reaching a vertex are stored as a sorted list of position ranges: a run-length compressed bitset.
+     *
+     * The vertices are identified by labels, usually their vertex IDs. Any other dense IDs work too, like the module
+     * IDs used to store the index in the cache. See @ref relabel.
+     */
+    class ReachabilityIndex
+    {
+    public:
+        //! A range of positions [first, last)
+        struct Range
+        {
+            std::uint32_t first = 0;
+            std::uint32_t last = 0;
+
+            bool operator==(const Range&) const = default;
+        };
+
+        //! An empty index
+        ReachabilityIndex() = default;
+
+        /**
+         * Create an index from its parts, as returned by @ref order, @ref offsets and @ref ranges.
+         *
+         * @throw std::runtime_error If the parts do not make up a valid index.
+         *
+         * @param order The label of the vertex at each position
+         * @param offsets The first range of each position, plus the total number of ranges at the end.
+         * @param ranges The ranges of positions that reach the vertex at each position
+         */
+        ReachabilityIndex(std::vector< std::uint32_t > order, std::vector< std::uint32_t > offsets,
+                          std::vector< Range > ranges)
+            : m_order(std::move(order)), m_offsets(std::move(offsets)), m_ranges(std::move(ranges))
+        {
+            auto size = m_order.size();
+            auto isValid = (m_offsets.size() == size + 1) && (m_offsets.front() == 0) &&
+                           (m_offsets.back() == m_ranges.size()) && std::ranges::is_sorted(m_offsets) &&
+                           std::ranges::all_of(m_ranges, [&](const Range& range)
+                                               { return (range.first < range.last) && (range.last <= size); });
+            if (!isValid)
+            {
+                throw std::runtime_error("Invalid reachability index.");
+            }
+
+            for (std::size_t position = 0; position < size; ++position)
+            {
+                auto label = m_order[position];
+                if (label >= m_positionOf.size())
+                {
+                    m_positionOf.resize(label + 1, none);
+                }
+                if (m_positionOf[label] != none)
+                {
+                    throw std::runtime_error("Invalid reachability index. Duplicate vertex.");
+                }
+                m_positionOf[label] = static_cast< std::uint32_t >(position);
+            }
+        }
+
+        /**
+         * Build the index of a graph.
+         *
+         * O(V + E * R), with R the average number of ranges per vertex. R is small for graphs that are mostly
+         * tree-like, as module graphs tend to be.
+         *
+         * @param condensation The condensation of the graph. See @ref Condensation.
+         *
+         * @return The index, labeled with vertex IDs.
+         */
+        [[nodiscard]] static ReachabilityIndex make(const Condensation& condensation)
+        {
+            const auto& dag = condensation.dag;
+            auto numComponents = dag.numVertices();
+
+            // Positions: a depth-first search along the reversed edges, starting at the components that do not have
+            // any edges of their own. Each component gets its positions once all components reaching it got theirs.
+            std::vector< std::uint32_t > order;
+            order.reserve(condensation.componentOf.size());
+            std::vector< Range > positionsOf(numComponents);
+            std::vector< bool > visited(numComponents, false);
+            std::vector< std::pair< std::uint32_t, std::size_t > > stack;
+            for (auto root : condensation.order)
+            {
+                if (visited[root])
+                {
+                    continue;
+                }
+                visited[root] = true;
+                stack.emplace_back(root, 0);
+                while (!stack.empty())
+                {
+                    auto& [component, next] = stack.back();
+                    auto predecessors = dag.predecessors(component);
+                    if (next < predecessors.size())
+                    {
+                        auto predecessor = predecessors[next++];
+                        if (!visited[predecessor])
+                        {
+                            visited[predecessor] = true;
+                            stack.emplace_back(predecessor, 0);
+                        }
+                        continue;
+                    }
+
+                    auto first = static_cast< std::uint32_t >(order.size());
+                    order.insert(order.end(), condensation.components[component].begin(),
+                                 condensation.components[component].end());
+                    positionsOf[component] = {.first = first, .last = static_cast< std::uint32_t >(order.size())};
+                    stack.pop_back();
+                }
+            }
+
+            // The ranges of each component: the union of the ranges of the components with an edge to it, plus
+            // those components themselves. Reversed build order, as the components reaching one come later in it.
+            std::vector< std::vector< Range > > rangesOf(numComponents);
+            std::vector< Range > collected;
+            for (auto component : condensation.order | std::views::reverse)
+            {
+                collected.clear();
+                for (auto predecessor : dag.predecessors(component))
+                {
+                    collected.insert(collected.end(), rangesOf[predecessor].begin(), rangesOf[predecessor].end());
+                    collected.push_back(positionsOf[predecessor]);
+                }
+                // The vertices of an SCC reach each other.
+                if (condensation.components[component].size() > 1)
+                {
+                    collected.push_back(positionsOf[component]);
+                }
+                rangesOf[component] = merge(collected);
+            }
+
+            // All vertices of a component share its ranges.
+            std::vector< std::uint32_t > offsets;
+            offsets.reserve(order.size() + 1);
+            std::vector< Range > ranges;
+            for (auto vertex : order)
+            {
+                offsets.push_back(static_cast< std::uint32_t >(ranges.size()));
+                const auto& own = rangesOf[condensation.componentOf[vertex]];
+                ranges.insert(ranges.end(), own.begin(), own.end());
+            }
+            offsets.push_back(static_cast< std::uint32_t >(ranges.size()));
+
+            return {std::move(order), std::move(offsets), std::move(ranges)};
+        }
+
+        /**
+         * Find all vertices that reach any of the given vertices. Vertices in an SCC reach themselves.
+         *
+         * O(R + N log N) for R ranges and N vertices found.
+         *
+         * @param labels The vertices. Unknown labels are ignored.
+         *
+         * @return The labels of the vertices that reach them, sorted.
+         */
+        [[nodiscard]] std::vector< std::uint32_t > reaching(std::span< const std::uint32_t > labels) const
+        {
+            std::vector< Range > collected;
+            for (auto label : labels)
+            {
+                if ((label >= m_positionOf.size()) || (m_positionOf[label] == none))
+                {
+                    continue;
+                }
+                auto position = m_positionOf[label];
+                collected.insert(collected.end(), m_ranges.begin() + m_offsets[position],
+                                 m_ranges.begin() + m_offsets[position + 1]);
+            }
+
+            std::vector< std::uint32_t > result;
+            for (const auto& range : merge(collected))
+            {
+                result.insert(result.end(), m_order.begin() + range.first, m_order.begin() + range.last);
+            }
+            std::ranges::sort(result);
+            return result;
+        }
+
+        /**
+         * A copy of this index with different labels.
+         *
+         * @param func Maps each label to its new label.
+         *
+         * @return The relabeled index
+         */
+        template < typename Func >
+        [[nodiscard]] ReachabilityIndex relabel(Func&& func) const
+        {
+            auto order = m_order;
+            std::ranges::transform(order, order.begin(), std::forward< Func >(func));
+            return {std::move(order), m_offsets, m_ranges};
+        }
+
+        //! The number of vertices
+        [[nodiscard]] std::size_t size() const
+        {
+            return m_order.size();
+        }
+
+        //! The label of the vertex at each position
+        [[nodiscard]] const std::vector< std::uint32_t >& order() const
+        {
+            return m_order;
+        }
+
+        //! The index of the first range of each position in @ref ranges, plus the number of ranges at the end.
+        [[nodiscard]] const std::vector< std::uint32_t >& offsets() const
+        {
+            return m_offsets;
+        }
+
+        //! The ranges of positions that reach each position, sorted and disjoint per position.
+        [[nodiscard]] const std::vector< Range >& ranges() const
+        {
+            return m_ranges;
+        }
+
+    private:
+        //! Marks a label without position
+        static constexpr auto none = std::numeric_limits< std::uint32_t >::max();
+
+        //! The label of the vertex at each position
+        std::vector< std::uint32_t > m_order;
+
+        //! The position of each label, or none.
+        std::vector< std::uint32_t > m_positionOf;
+
+        //! The first range of each position, plus the number of ranges at the end.
+        std::vector< std::uint32_t > m_offsets = {0};
+
+        //! The ranges of all positions
+        std::vector< Range > m_ranges;
+
+        /**
+         * Merge ranges that overlap or touch.
+         *
+         * @param ranges The ranges. Get sorted.
+         *
+         * @return The sorted, disjoint ranges
+         */
+        [[nodiscard]] static std::vector< Range > merge(std::vector< Range >& ranges)
+        {
+            std::ranges::sort(ranges, {}, &Range::first);
+
+            std::vector< Range > result;
+            for (const auto& range : ranges)
+            {
+                if (!result.empty() && (range.first <= result.back().last))
+                {
+                    result.back().last = std::max(result.back().last, range.last);
+                }
+                else
+                {
+                    result.push_back(range);
+                }
+            }
+            return result;
+        }
+    };
+} // namespace mgt
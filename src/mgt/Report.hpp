@@ -0,0 +1,802 @@
+#pragma once
+
+#include "DDI.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mgt
+{
+    //! The format of a @ref Report
+    enum class OutputFormat
+    {
+        //! For humans
+        text,
+        //! A JSON document of the summary and the diagnostics
+        json,
+        //! SARIF 2.1.0, as understood by code scanning tools and IDEs
+        sarif
+    };
+
+    /**
+     * Parse an output format: "text", "json" or "sarif".
+     *
+     * @param name The name of the format
+     * @param format The format to set
+     *
+     * @return False if the name is unknown.
+     */
+    [[nodiscard]] inline bool parseOutputFormat(std::string_view name, OutputFormat& format)
+    {
+        if (name == "text")
+        {
+            format = OutputFormat::text;
+        }
+        else if (name == "json")
+        {
+            format = OutputFormat::json;
+        }
+        else if (name == "sarif")
+        {
+            format = OutputFormat::sarif;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    //! How severe a diagnostic is
+    enum class Severity
+    {
+        warning,
+        error
+    };
+
+    //! A kind of issue. The ID and the name are stable, tools may rely on them.
+    struct DiagnosticCode
+    {
+        //! The ID, like MGT001
+        std::string_view id;
+        //! The name, like MultipleSources
+        std::string_view name;
+        //! How severe the issue is
+        Severity severity;
+        //! What the issue is about
+        std::string_view description;
+        //! How to fix it. Optional.
+        std::string_view help;
+    };
+
+    //! The codes of all diagnostics. Never re-use or re-number a code.
+    namespace codes
+    {
+        inline constexpr std::string_view sharedModuleHelp =
+            "This is likely to be caused by multiple targets sharing the same module code. Also, be sure to import "
+            "module code instead of #including it.";
+
+        inline constexpr DiagnosticCode multipleSources{.id = "MGT001",
+                                                        .name = "MultipleSources",
+                                                        .severity = Severity::warning,
+                                                        .description = "A module is provided by more than one source.",
+                                                        .help = sharedModuleHelp};
+
+        inline constexpr DiagnosticCode multipleTargets{.id = "MGT002",
+                                                        .name = "MultipleTargets",
+                                                        .severity = Severity::warning,
+                                                        .description = "A module is provided by more than one target.",
+                                                        .help = sharedModuleHelp};
+
+        inline constexpr DiagnosticCode missingModule{.id = "MGT003",
+                                                      .name = "MissingModule",
+                                                      .severity = Severity::error,
+                                                      .description = "A module is imported, but no source provides it.",
+                                                      .help = {}};
+
+        inline constexpr DiagnosticCode circularDependency{.id = "MGT004",
+                                                           .name = "CircularDependency",
+                                                           .severity = Severity::error,
+                                                           .description = "Modules import each other in a cycle.",
+                                                           .help = {}};
+
+        //! All codes, sorted by ID
+        inline constexpr std::array all{&multipleSources, &multipleTargets, &missingModule, &circularDependency};
+    } // namespace codes
+
+    /**
+     * The result of analyzing a graph: a summary and the diagnostics, to be written as text, JSON or SARIF. Built by
+     * @ref ModuleGraph::report and @ref BuildGraph::report.
+     *
+     * Names and paths are views, mostly into the symbol tables of the graph. The report must not outlive the graph.
+     * The lists of a diagnostic are ranges of shared pools, so adding a diagnostic does not allocate per name. All
+     * output is formatted into one buffer, which is written at once.
+     */
+    class Report
+    {
+    public:
+        //! A part of one of the pools
+        struct Range
+        {
+            std::uint32_t first = 0;
+            std::uint32_t count = 0;
+        };
+
+        //! A source file providing a module
+        struct Source
+        {
+            //! The target of the source. Empty if not known.
+            std::string_view target;
+            //! The path of the source
+            std::string_view path;
+        };
+
+        //! An issue
+        struct Diagnostic
+        {
+            //! What kind of issue
+            const DiagnosticCode* code = nullptr;
+            //! The module the issue is about. Empty for circular dependencies.
+            std::string_view module;
+            //! The target the issue was found in. Empty if found in the whole graph.
+            std::string_view target;
+            //! The targets a circular dependency spans. A range of @ref Report::names.
+            Range targets;
+            //! The sources providing the module. A range of @ref Report::sources.
+            Range sources;
+            //! The modules of a circular dependency. A range of @ref Report::names.
+            Range modules;
+            //! The shortest cycles of a circular dependency. A range of @ref Report::cycles.
+            Range cycles;
+        };
+
+        //! A target of a build
+        struct Target
+        {
+            std::string_view name;
+            std::size_t numFiles = 0;
+            std::size_t numModules = 0;
+        };
+
+        //! How many files were taken from the cache
+        struct CacheStats
+        {
+            std::size_t hits = 0;
+            std::size_t misses = 0;
+        };
+
+        //! What was analyzed
+        struct Summary
+        {
+            //! The location the DDI files were loaded from
+            std::string path;
+            //! The number of loaded DDI files
+            std::size_t numFiles = 0;
+            //! How the DDI files were loaded. Not set if the graph was not loaded from a directory.
+            std::optional< ddi::LoadTimes > loadTimes;
+            //! Not set if no cache was used
+            std::optional< CacheStats > cacheStats;
+            //! The number of modules
+            std::size_t numModules = 0;
+            //! The number of translation units that import modules without providing one
+            std::size_t numConsumers = 0;
+            //! The number of target directories of a build. Not set for a single graph.
+            std::optional< std::size_t > numTargetDirectories;
+            //! The targets with modules
+            std::vector< Target > targets;
+        };
+
+        //! What was analyzed
+        [[nodiscard]] Summary& summary()
+        {
+            return m_summary;
+        }
+
+        //! What was analyzed
+        [[nodiscard]] const Summary& summary() const
+        {
+            return m_summary;
+        }
+
+        /**
+         * Add a diagnostic. Its lists are filled by the following calls to @ref addSource, @ref addTarget,
+         * @ref setModules and @ref addCycle.
+         *
+         * @param code What kind of issue
+         * @param module The module the issue is about, if any.
+         * @param target The target the issue was found in, if any.
+         */
+        void add(const DiagnosticCode& code, std::string_view module = {}, std::string_view target = {})
+        {
+            m_diagnostics.push_back({.code = &code,
+                                     .module = module,
+                                     .target = target,
+                                     .targets = {.first = size(m_names), .count = 0},
+                                     .sources = {.first = size(m_sources), .count = 0},
+                                     .modules = {},
+                                     .cycles = {.first = size(m_cycles), .count = 0}});
+            if (code.severity == Severity::error)
+            {
+                m_numErrors++;
+            }
+            else
+            {
+                m_numWarnings++;
+            }
+        }
+
+        //! Add a source providing the module to the last diagnostic.
+        void addSource(std::string_view path, std::string_view target = {})
+        {
+            m_sources.push_back({.target = target, .path = path});
+            m_diagnostics.back().sources.count++;
+        }
+
+        //! Add a target to the last diagnostic. Must be called before @ref setModules and @ref addCycle.
+        void addTarget(std::string_view target)
+        {
+            m_names.push_back(target);
+            m_diagnostics.back().targets.count++;
+        }
+
+        //! Set the modules of the last diagnostic, a circular dependency.
+        template < std::ranges::input_range Names >
+        void setModules(Names&& names)
+        {
+            m_diagnostics.back().modules = append(std::forward< Names >(names));
+        }
+
+        //! Add a cycle to the last diagnostic, a circular dependency.
+        template < std::ranges::input_range Names >
+        void addCycle(Names&& names)
+        {
+            m_cycles.push_back(append(std::forward< Names >(names)));
+            m_diagnostics.back().cycles.count++;
+        }
+
+        //! The diagnostics in the order they were added
+        [[nodiscard]] std::span< const Diagnostic > diagnostics() const
+        {
+            return m_diagnostics;
+        }
+
+        //! A list of names of a diagnostic
+        [[nodiscard]] std::span< const std::string_view > names(Range range) const
+        {
+            return std::span(m_names).subspan(range.first, range.count);
+        }
+
+        //! The sources of a diagnostic
+        [[nodiscard]] std::span< const Source > sources(Range range) const
+        {
+            return std::span(m_sources).subspan(range.first, range.count);
+        }
+
+        //! The cycles of a diagnostic. Each one is a range of @ref names.
+        [[nodiscard]] std::span< const Range > cycles(Range range) const
+        {
+            return std::span(m_cycles).subspan(range.first, range.count);
+        }
+
+        //! The number of warnings
+        [[nodiscard]] std::size_t numWarnings() const
+        {
+            return m_numWarnings;
+        }
+
+        //! The number of errors
+        [[nodiscard]] std::size_t numErrors() const
+        {
+            return m_numErrors;
+        }
+
+        /**
+         * Format the report. The diagnostics are ordered by their code.
+         *
+         * @param format The format
+         *
+         * @return The formatted report. Valid until the report is formatted again.
+         */
+        [[nodiscard]] std::string_view format(OutputFormat format)
+        {
+            m_buffer.clear();
+            auto out = std::back_inserter(m_buffer);
+
+            std::vector< std::uint32_t > order(m_diagnostics.size());
+            for (std::uint32_t i = 0; i < order.size(); ++i)
+            {
+                order[i] = i;
+            }
+            std::ranges::stable_sort(order, {}, [&](auto i) { return m_diagnostics[i].code->id; });
+
+            switch (format)
+            {
+                case OutputFormat::text:
+                    formatText(out, order);
+                    break;
+                case OutputFormat::json:
+                    formatJSON(out, order);
+                    break;
+                case OutputFormat::sarif:
+                    formatSARIF(out, order);
+                    break;
+            }
+            return m_buffer;
+        }
+
+        /**
+         * Format the report and write it with one call.
+         *
+         * @param stream Where to write to
+         * @param format The format
+         */
+        void write(std::ostream& stream, OutputFormat format)
+        {
+            auto formatted = this->format(format);
+            stream.write(formatted.data(), static_cast< std::streamsize >(formatted.size()));
+        }
+
+    private:
+        using Out = std::back_insert_iterator< std::string >;
+
+        Summary m_summary;
+        std::vector< Diagnostic > m_diagnostics;
+
+        //! The pools the lists of the diagnostics point into
+        std::vector< std::string_view > m_names;
+        std::vector< Source > m_sources;
+        std::vector< Range > m_cycles;
+
+        std::size_t m_numWarnings = 0;
+        std::size_t m_numErrors = 0;
+
+        //! The formatted report. Re-used.
+        std::string m_buffer;
+
+        //! The message of a diagnostic, before escaping it. Re-used.
+        std::string m_message;
+
+        template < typename Container >
+        [[nodiscard]] static std::uint32_t size(const Container& container)
+        {
+            return static_cast< std::uint32_t >(container.size());
+        }
+
+        //! Append names to the name pool.
+        template < std::ranges::input_range Names >
+        [[nodiscard]] Range append(Names&& names)
+        {
+            Range result{.first = size(m_names), .count = 0};
+            for (std::string_view name : names)
+            {
+                m_names.push_back(name);
+            }
+            result.count = size(m_names) - result.first;
+            return result;
+        }
+
+        //! Write names with a separator
+        static void join(Out out, std::span< const std::string_view > names, std::string_view separator)
+        {
+            for (std::size_t i = 0; i < names.size(); ++i)
+            {
+                std::format_to(out, "{}{}", (i == 0) ? "" : separator, names[i]);
+            }
+        }
+
+        //! Write the one-line description of a diagnostic.
+        void formatMessage(Out out, const Diagnostic& diagnostic) const
+        {
+            const auto& code = *diagnostic.code;
+            if (&code == &codes::multipleSources)
+            {
+                std::format_to(out, "multiple sources for module \"{}\"", diagnostic.module);
+            }
+            else if (&code == &codes::multipleTargets)
+            {
+                std::format_to(out, "module \"{}\" is provided by multiple targets", diagnostic.module);
+            }
+            else if (&code == &codes::missingModule)
+            {
+                std::format_to(out, "No source provides the module: {}", diagnostic.module);
+            }
+            else if (&code == &codes::circularDependency)
+            {
+                std::format_to(out, "Circular dependency");
+            }
+
+            if (!diagnostic.target.empty())
+            {
+                std::format_to(out, " in target {}", diagnostic.target);
+            }
+            if (diagnostic.targets.count > 0)
+            {
+                std::format_to(out, " across targets ");
+                join(out, names(diagnostic.targets), ", ");
+            }
+        }
+
+        void formatText(Out out, std::span< const std::uint32_t > order) const
+        {
+            std::format_to(out, "Report for {}\n\n", m_summary.path);
+            if (const auto& times = m_summary.loadTimes)
+            {
+                std::format_to(out, "Loaded {} DDI files. Discovery ({}): {:.2f} ms, parsing: {:.2f} ms\n",
+                               m_summary.numFiles, ddi::toString(times->source), times->discovery.count(),
+                               times->parsing.count());
+            }
+            if (const auto& cache = m_summary.cacheStats)
+            {
+                std::format_to(out, "Cache: {} hits, {} misses\n", cache->hits, cache->misses);
+            }
+            if (m_summary.numConsumers > 0)
+            {
+                std::format_to(out, "Modules: {}, other translation units importing modules: {}\n",
+                               m_summary.numModules, m_summary.numConsumers);
+            }
+            if (m_summary.loadTimes || m_summary.cacheStats || (m_summary.numConsumers > 0))
+            {
+                std::format_to(out, "\n");
+            }
+
+            if (m_summary.numTargetDirectories)
+            {
+                std::format_to(out, "Targets with modules: {} of {}, modules: {}\n", m_summary.targets.size(),
+                               *m_summary.numTargetDirectories, m_summary.numModules);
+                for (const auto& target : m_summary.targets)
+                {
+                    std::format_to(out, "   -> {}: {} DDI files, {} modules\n", target.name, target.numFiles,
+                                   target.numModules);
+                }
+                std::format_to(out, "\n");
+            }
+
+            for (std::size_t i = 0; i < order.size(); ++i)
+            {
+                const auto& diagnostic = m_diagnostics[order[i]];
+                const auto& code = *diagnostic.code;
+                auto hasDetails = (diagnostic.sources.count > 0) || (diagnostic.modules.count > 0);
+
+                std::format_to(out, "{}: [{}] ", (code.severity == Severity::error) ? "E" : "W", code.id);
+                formatMessage(out, diagnostic);
+                std::format_to(out, "{}\n", hasDetails ? ":" : "");
+
+                // Sources of different targets get a line each, the sources within a target share one.
+                auto sources = this->sources(diagnostic.sources);
+                if (!sources.empty() && sources.front().target.empty())
+                {
+                    std::format_to(out, "   -> ");
+                    for (std::size_t j = 0; j < sources.size(); ++j)
+                    {
+                        std::format_to(out, "{}{}", (j == 0) ? "" : ", ", sources[j].path);
+                    }
+                    std::format_to(out, "\n");
+                }
+                else
+                {
+                    for (const auto& source : sources)
+                    {
+                        std::format_to(out, "   -> {}: {}\n", source.target, source.path);
+                    }
+                }
+
+                if (diagnostic.modules.count > 0)
+                {
+                    std::format_to(out, "   -> Strongly connected components: ");
+                    join(out, names(diagnostic.modules), ", ");
+                    std::format_to(out, "\n");
+                }
+                for (const auto& [j, cycle] : cycles(diagnostic.cycles) | std::views::enumerate)
+                {
+                    std::format_to(out, "   -> {}: ", (j == 0) ? "Shortest cycle" : "Other cycle");
+                    join(out, names(cycle), " -> ");
+                    std::format_to(out, "\n");
+                }
+
+                // The hint once after all diagnostics that share it
+                auto isLast = (i + 1 == order.size()) || (m_diagnostics[order[i + 1]].code->help != code.help);
+                if (!code.help.empty() && isLast)
+                {
+                    std::format_to(out, "HINT: {}\n", code.help);
+                }
+            }
+
+            std::format_to(out, "{}Warnings: {}, Errors: {}\n", order.empty() ? "" : "\n", m_numWarnings,
+                           m_numErrors);
+        }
+
+        //! Write a JSON string, with quotes.
+        static void formatString(Out out, std::string_view str)
+        {
+            *out++ = '"';
+            for (auto c : str)
+            {
+                switch (c)
+                {
+                    case '"':
+                        std::format_to(out, "\\\"");
+                        break;
+                    case '\\':
+                        std::format_to(out, "\\\\");
+                        break;
+                    case '\n':
+                        std::format_to(out, "\\n");
+                        break;
+                    case '\r':
+                        std::format_to(out, "\\r");
+                        break;
+                    case '\t':
+                        std::format_to(out, "\\t");
+                        break;
+                    default:
+                        if (static_cast< unsigned char >(c) < 0x20)
+                        {
+                            std::format_to(out, "\\u{:04x}", static_cast< unsigned >(c));
+                        }
+                        else
+                        {
+                            *out++ = c;
+                        }
+                }
+            }
+            *out++ = '"';
+        }
+
+        //! Write a JSON array of strings.
+        static void formatStrings(Out out, std::span< const std::string_view > strings)
+        {
+            *out++ = '[';
+            for (std::size_t i = 0; i < strings.size(); ++i)
+            {
+                std::format_to(out, "{}", (i == 0) ? "" : ", ");
+                formatString(out, strings[i]);
+            }
+            *out++ = ']';
+        }
+
+        //! Write the message of a diagnostic as a JSON string.
+        void formatMessageString(Out out, const Diagnostic& diagnostic)
+        {
+            m_message.clear();
+            formatMessage(std::back_inserter(m_message), diagnostic);
+            formatString(out, m_message);
+        }
+
+        void formatJSON(Out out, std::span< const std::uint32_t > order)
+        {
+            std::format_to(out, "{{\n  \"version\": 1,\n  \"path\": ");
+            formatString(out, m_summary.path);
+            std::format_to(out, ",\n  \"files\": {},\n  \"modules\": {},\n  \"consumers\": {}", m_summary.numFiles,
+                           m_summary.numModules, m_summary.numConsumers);
+            if (const auto& times = m_summary.loadTimes)
+            {
+                std::format_to(out,
+                               ",\n  \"load\": {{\"discovery\": \"{}\", \"discoveryMs\": {:.3f}, "
+                               "\"parsingMs\": {:.3f}}}",
+                               ddi::toString(times->source), times->discovery.count(), times->parsing.count());
+            }
+            if (const auto& cache = m_summary.cacheStats)
+            {
+                std::format_to(out, ",\n  \"cache\": {{\"hits\": {}, \"misses\": {}}}", cache->hits, cache->misses);
+            }
+            if (m_summary.numTargetDirectories)
+            {
+                std::format_to(out, ",\n  \"targetDirectories\": {},\n  \"targets\": [",
+                               *m_summary.numTargetDirectories);
+                for (const auto& [i, target] : m_summary.targets | std::views::enumerate)
+                {
+                    std::format_to(out, "{}\n    {{\"name\": ", (i == 0) ? "" : ",");
+                    formatString(out, target.name);
+                    std::format_to(out, ", \"files\": {}, \"modules\": {}}}", target.numFiles, target.numModules);
+                }
+                std::format_to(out, "\n  ]");
+            }
+
+            std::format_to(out, ",\n  \"diagnostics\": [");
+            for (std::size_t i = 0; i < order.size(); ++i)
+            {
+                const auto& diagnostic = m_diagnostics[order[i]];
+                const auto& code = *diagnostic.code;
+                std::format_to(out, "{}\n    {{\"code\": \"{}\", \"name\": \"{}\", \"severity\": \"{}\", \"message\": ",
+                               (i == 0) ? "" : ",", code.id, code.name,
+                               (code.severity == Severity::error) ? "error" : "warning");
+                formatMessageString(out, diagnostic);
+                if (!diagnostic.module.empty())
+                {
+                    std::format_to(out, ", \"module\": ");
+                    formatString(out, diagnostic.module);
+                }
+                if (!diagnostic.target.empty())
+                {
+                    std::format_to(out, ", \"target\": ");
+                    formatString(out, diagnostic.target);
+                }
+                if (diagnostic.targets.count > 0)
+                {
+                    std::format_to(out, ", \"targets\": ");
+                    formatStrings(out, names(diagnostic.targets));
+                }
+                if (diagnostic.sources.count > 0)
+                {
+                    std::format_to(out, ", \"sources\": [");
+                    for (const auto& [j, source] : sources(diagnostic.sources) | std::views::enumerate)
+                    {
+                        std::format_to(out, "{}{{\"path\": ", (j == 0) ? "" : ", ");
+                        formatString(out, source.path);
+                        if (!source.target.empty())
+                        {
+                            std::format_to(out, ", \"target\": ");
+                            formatString(out, source.target);
+                        }
+                        *out++ = '}';
+                    }
+                    *out++ = ']';
+                }
+                if (diagnostic.modules.count > 0)
+                {
+                    std::format_to(out, ", \"modules\": ");
+                    formatStrings(out, names(diagnostic.modules));
+                }
+                if (diagnostic.cycles.count > 0)
+                {
+                    std::format_to(out, ", \"cycles\": [");
+                    for (const auto& [j, cycle] : cycles(diagnostic.cycles) | std::views::enumerate)
+                    {
+                        std::format_to(out, "{}", (j == 0) ? "" : ", ");
+                        formatStrings(out, names(cycle));
+                    }
+                    *out++ = ']';
+                }
+                *out++ = '}';
+            }
+            std::format_to(out, "{}],\n  \"warnings\": {},\n  \"errors\": {}\n}}\n", order.empty() ? "" : "\n  ",
+                           m_numWarnings, m_numErrors);
+        }
+
+        //! Write a path as URI reference: file:// for absolute paths, percent-encoded.
+        static void formatURI(Out out, std::string_view path)
+        {
+            auto hasDrive = (path.size() >= 2) && (path[1] == ':');
+            if (path.starts_with('/'))
+            {
+                std::format_to(out, "file://");
+            }
+            else if (hasDrive)
+            {
+                std::format_to(out, "file:///");
+            }
+
+            for (auto c : path)
+            {
+                auto byte = static_cast< unsigned char >(c);
+                auto isPlain = ((byte >= 'a') && (byte <= 'z')) || ((byte >= 'A') && (byte <= 'Z')) ||
+                               ((byte >= '0') && (byte <= '9')) || std::string_view("-._~/:").contains(c);
+                if (c == '\\')
+                {
+                    *out++ = '/';
+                }
+                else if (isPlain)
+                {
+                    *out++ = c;
+                }
+                else
+                {
+                    std::format_to(out, "%{:02X}", static_cast< unsigned >(byte));
+                }
+            }
+        }
+
+        //! Write a SARIF location that names modules.
+        static void formatLogicalLocation(Out out, std::string_view module)
+        {
+            std::format_to(out, "{{\"logicalLocations\": [{{\"kind\": \"module\", \"name\": ");
+            formatString(out, module);
+            std::format_to(out, "}}]}}");
+        }
+
+        void formatSARIF(Out out, std::span< const std::uint32_t > order)
+        {
+            std::format_to(out, "{{\n  \"$schema\": \"https://json.schemastore.org/sarif-2.1.0.json\",\n"
+                                "  \"version\": \"2.1.0\",\n  \"runs\": [{{\n"
+                                "    \"tool\": {{\"driver\": {{\"name\": \"mgt\", "
+                                "\"informationUri\": \"https://github.com/seichelbaum/module-graph-tool\", "
+                                "\"rules\": [");
+            for (const auto& [i, code] : codes::all | std::views::enumerate)
+            {
+                std::format_to(out, "{}\n      {{\"id\": \"{}\", \"name\": \"{}\", \"shortDescription\": {{\"text\": ",
+                               (i == 0) ? "" : ",", code->id, code->name);
+                formatString(out, code->description);
+                *out++ = '}';
+                if (!code->help.empty())
+                {
+                    std::format_to(out, ", \"help\": {{\"text\": ");
+                    formatString(out, code->help);
+                    *out++ = '}';
+                }
+                std::format_to(out, ", \"defaultConfiguration\": {{\"level\": \"{}\"}}}}",
+                               (code->severity == Severity::error) ? "error" : "warning");
+            }
+            std::format_to(out, "\n    ]}}}},\n    \"results\": [");
+
+            for (std::size_t i = 0; i < order.size(); ++i)
+            {
+                const auto& diagnostic = m_diagnostics[order[i]];
+                const auto& code = *diagnostic.code;
+                auto ruleIndex = std::ranges::find(codes::all, &code) - codes::all.begin();
+                std::format_to(out, "{}\n      {{\"ruleId\": \"{}\", \"ruleIndex\": {}, \"level\": \"{}\", "
+                                    "\"message\": {{\"text\": ",
+                               (i == 0) ? "" : ",", code.id, ruleIndex,
+                               (code.severity == Severity::error) ? "error" : "warning");
+                formatMessageString(out, diagnostic);
+
+                // The sources providing the module, or the module, or the modules of a circular dependency.
+                std::format_to(out, "}}, \"locations\": [");
+                if (diagnostic.sources.count > 0)
+                {
+                    for (const auto& [j, source] : sources(diagnostic.sources) | std::views::enumerate)
+                    {
+                        std::format_to(out, "{}{{\"physicalLocation\": {{\"artifactLocation\": {{\"uri\": \"",
+                                       (j == 0) ? "" : ", ");
+                        formatURI(out, source.path);
+                        std::format_to(out, "\"}}}}}}");
+                    }
+                }
+                else if (!diagnostic.module.empty())
+                {
+                    formatLogicalLocation(out, diagnostic.module);
+                }
+                else
+                {
+                    for (const auto& [j, module] : names(diagnostic.modules) | std::views::enumerate)
+                    {
+                        std::format_to(out, "{}", (j == 0) ? "" : ", ");
+                        formatLogicalLocation(out, module);
+                    }
+                }
+                *out++ = ']';
+
+                if (!diagnostic.target.empty() || (diagnostic.targets.count > 0) || (diagnostic.cycles.count > 0))
+                {
+                    std::format_to(out, ", \"properties\": {{");
+                    auto separator = "";
+                    if (!diagnostic.target.empty())
+                    {
+                        std::format_to(out, "\"target\": ");
+                        formatString(out, diagnostic.target);
+                        separator = ", ";
+                    }
+                    if (diagnostic.targets.count > 0)
+                    {
+                        std::format_to(out, "{}\"targets\": ", separator);
+                        formatStrings(out, names(diagnostic.targets));
+                        separator = ", ";
+                    }
+                    if (diagnostic.cycles.count > 0)
+                    {
+                        std::format_to(out, "{}\"cycles\": [", separator);
+                        for (const auto& [j, cycle] : cycles(diagnostic.cycles) | std::views::enumerate)
+                        {
+                            std::format_to(out, "{}", (j == 0) ? "" : ", ");
+                            formatStrings(out, names(cycle));
+                        }
+                        *out++ = ']';
+                    }
+                    *out++ = '}';
+                }
+                *out++ = '}';
+            }
+            std::format_to(out, "{}]\n  }}]\n}}\n", order.empty() ? "" : "\n    ");
+        }
+    };
+} // namespace mgt
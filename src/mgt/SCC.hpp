@@ -0,0 +1,507 @@
+#pragma once
+
+#include "CSRGraph.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    //! A list of strongly connected components. Each component is a list of vertices.
+    using SCCs = std::vector< std::vector< VertexId > >;
+
+    //! The algorithms to find SCCs with.
+    enum class SCCAlgorithm
+    {
+        //! Tarjan for small graphs or a single thread, forward-backward otherwise.
+        automatic,
+        //! Iterative Tarjan. Single-threaded, linear time.
+        tarjan,
+        //! Trimming plus parallel forward-backward decomposition.
+        forwardBackward
+    };
+
+    //! Options for @ref stronglyConnectedComponents
+    struct SCCOptions
+    {
+        //! Only components with at least this number of vertices are returned.
+        std::size_t minSize = 1;
+
+        //! The number of threads to use
+        unsigned jobs = 1;
+
+        //! The algorithm to use
+        SCCAlgorithm algorithm = SCCAlgorithm::automatic;
+
+        //! With @ref SCCAlgorithm::automatic, graphs with at least this number of vertices + edges are processed with
+        //! the parallel algorithm.
+        std::size_t parallelThreshold = 200'000;
+    };
+
+    namespace detail
+    {
+        /**
+         * Tarjan's algorithm on a subset of the vertices of a graph. Iterative, so deep graphs cannot overflow the
+         * stack.
+         *
+         * @param graph The graph
+         * @param roots The vertices of the subset. The DFS starts from each of them in this order.
+         * @param inSubset Returns true for each vertex in the subset. Edges to other vertices are ignored.
+         * @param local Maps each vertex of the subset to a unique number in [0, roots.size()).
+         * @param emit Called with each component, as a pair of iterators. In reverse topological order.
+         */
+        template < typename Roots, typename InSubset, typename Local, typename Emit >
+        void tarjan(const CSRGraph& graph, const Roots& roots, InSubset&& inSubset, Local&& local, Emit&& emit)
+        {
+            constexpr auto unvisited = std::numeric_limits< std::uint32_t >::max();
+
+            // Indexed by the local number of a vertex. Keeps the memory proportional to the subset.
+            auto size = static_cast< std::size_t >(std::ranges::distance(roots));
+            std::vector< std::uint32_t > index(size, unvisited);
+            std::vector< std::uint32_t > lowLink(size, 0);
+            std::vector< bool > onStack(size, false);
+            std::vector< VertexId > stack;
+
+            // The DFS call stack: the vertex and the position in its successors.
+            struct Frame
+            {
+                VertexId vertex;
+                std::uint32_t next;
+            };
+            std::vector< Frame > callStack;
+
+            std::uint32_t nextIndex = 0;
+            auto enter = [&](VertexId vertex)
+            {
+                auto i = local(vertex);
+                index[i] = lowLink[i] = nextIndex++;
+                stack.push_back(vertex);
+                onStack[i] = true;
+                callStack.push_back({.vertex = vertex, .next = 0});
+            };
+
+            for (auto root : roots)
+            {
+                if (index[local(root)] != unvisited)
+                {
+                    continue;
+                }
+
+                enter(root);
+                while (!callStack.empty())
+                {
+                    auto& frame = callStack.back();
+                    auto vertex = frame.vertex;
+                    auto current = local(vertex);
+                    auto successors = graph.successors(vertex);
+
+                    if (frame.next < successors.size())
+                    {
+                        auto successor = successors[frame.next++];
+                        if (!inSubset(successor))
+                        {
+                            continue;
+                        }
+                        auto next = local(successor);
+                        if (index[next] == unvisited)
+                        {
+                            enter(successor); // "Recurse"
+                        }
+                        else if (onStack[next])
+                        {
+                            lowLink[current] = std::min(lowLink[current], index[next]);
+                        }
+                        continue;
+                    }
+
+                    // All successors done. If this is the root of a component, pop it from the stack.
+                    if (lowLink[current] == index[current])
+                    {
+                        auto first = stack.end();
+                        do
+                        {
+                            --first;
+                        } while (*first != vertex);
+
+                        emit(first, stack.end());
+                        for (auto it = first; it != stack.end(); ++it)
+                        {
+                            onStack[local(*it)] = false;
+                        }
+                        stack.erase(first, stack.end());
+                    }
+
+                    // "Return" to the caller
+                    callStack.pop_back();
+                    if (!callStack.empty())
+                    {
+                        auto caller = local(callStack.back().vertex);
+                        lowLink[caller] = std::min(lowLink[caller], lowLink[current]);
+                    }
+                }
+            }
+        }
+
+        /**
+         * The forward-backward algorithm with trimming.
+         *
+         * First, vertices without predecessors or successors are trimmed repeatedly. They are components of their own.
+         * Module graphs are mostly acyclic, so this usually leaves only a small part of the graph.
+         *
+         * The rest is split into independent sub-problems: all vertices reachable from a pivot (forward) and all
+         * vertices reaching it (backward) are searched. The intersection is the component of the pivot. Every other
+         * component is entirely within forward only, backward only, or neither. These three sets are processed in
+         * parallel. Small sets are processed with Tarjan.
+         *
+         * Splitting off one small component at a time costs a search of the whole set each time. So, if the pivot's
+         * component is small compared to the set, the set is processed with Tarjan too.
+         */
+        class ForwardBackward
+        {
+        public:
+            ForwardBackward(const CSRGraph& graph, std::size_t minSize, unsigned jobs)
+                : m_graph(graph), m_minSize(minSize), m_jobs(std::max(1U, jobs)),
+                  m_color(graph.numVertices(), trimmed), m_local(graph.numVertices(), 0),
+                  m_mark(graph.numVertices(), 0), m_results(m_jobs)
+            {
+            }
+
+            //! Run the algorithm. The components are sorted, each component too.
+            [[nodiscard]] SCCs run()
+            {
+                auto remaining = trim();
+                if (!remaining.empty())
+                {
+                    for (auto vertex : remaining)
+                    {
+                        m_color[vertex] = 0;
+                    }
+                    m_pending = 1;
+                    m_queue.push(Task{.color = 0, .vertices = std::move(remaining)});
+
+                    parallelFor(m_jobs, m_jobs,
+                                [&]([[maybe_unused]] std::size_t i, unsigned worker)
+                                {
+                                    while (auto task = m_queue.pop())
+                                    {
+                                        process(*task, m_results[worker]);
+                                        if (--m_pending == 0)
+                                        {
+                                            m_queue.close();
+                                        }
+                                    }
+                                });
+                }
+
+                SCCs result;
+                for (auto& components : m_results)
+                {
+                    for (auto& component : components)
+                    {
+                        result.push_back(std::move(component));
+                    }
+                }
+                for (auto& component : m_trimmed)
+                {
+                    result.push_back(std::move(component));
+                }
+
+                // Tasks run in any order. Sort to get the same result every time.
+                for (auto& component : result)
+                {
+                    std::ranges::sort(component);
+                }
+                std::ranges::sort(result, {}, [](const auto& component) { return component.front(); });
+                return result;
+            }
+
+        private:
+            //! A set of vertices that contains whole components only. All vertices in it have the same color.
+            struct Task
+            {
+                std::uint32_t color;
+                std::vector< VertexId > vertices;
+            };
+
+            //! The color of trimmed vertices and of vertices whose component has been found.
+            static constexpr auto trimmed = std::numeric_limits< std::uint32_t >::max();
+
+            //! Tasks with fewer vertices are processed with Tarjan.
+            static constexpr std::size_t tarjanThreshold = 4096;
+
+            //! The pivot's component must contain at least 1/N of the vertices of a task to continue splitting it.
+            static constexpr std::size_t minComponentShare = 4;
+
+            //! Bits in m_mark
+            static constexpr std::uint8_t forward = 1;
+            static constexpr std::uint8_t backward = 2;
+
+            const CSRGraph& m_graph;
+            std::size_t m_minSize;
+            unsigned m_jobs;
+
+            //! The task each vertex belongs to. Tasks are disjoint, so concurrent tasks never write the same entries. But
+            //! they read the colors of neighbours in other tasks. Use @ref colorOf and @ref setColor while tasks run.
+            std::vector< std::uint32_t > m_color;
+
+            //! The number of each vertex within its task. Only used for Tarjan.
+            std::vector< std::uint32_t > m_local;
+
+            //! The forward/backward marks per vertex
+            std::vector< std::uint8_t > m_mark;
+
+            //! The next free color
+            std::atomic< std::uint32_t > m_nextColor = 1;
+
+            //! The pending tasks
+            WorkQueue< Task > m_queue;
+
+            //! The number of tasks that are queued or running
+            std::atomic< std::size_t > m_pending = 0;
+
+            //! The components found by each worker
+            std::vector< SCCs > m_results;
+
+            //! The components of the trimmed vertices
+            SCCs m_trimmed;
+
+            //! Remove all vertices without predecessors or successors, repeatedly. Returns the remaining vertices.
+            [[nodiscard]] std::vector< VertexId > trim()
+            {
+                auto numVertices = static_cast< VertexId >(m_graph.numVertices());
+                std::vector< std::uint32_t > numIn(numVertices);
+                std::vector< std::uint32_t > numOut(numVertices);
+                std::vector< bool > removed(numVertices, false);
+                std::vector< VertexId > queue;
+
+                auto remove = [&](VertexId vertex)
+                {
+                    removed[vertex] = true;
+                    queue.push_back(vertex);
+                    if (m_minSize <= 1)
+                    {
+                        m_trimmed.push_back({vertex});
+                    }
+                };
+
+                for (VertexId vertex = 0; vertex < numVertices; ++vertex)
+                {
+                    numIn[vertex] = static_cast< std::uint32_t >(m_graph.inDegree(vertex));
+                    numOut[vertex] = static_cast< std::uint32_t >(m_graph.outDegree(vertex));
+                    if ((numIn[vertex] == 0) || (numOut[vertex] == 0))
+                    {
+                        remove(vertex);
+                    }
+                }
+
+                for (std::size_t head = 0; head < queue.size(); ++head)
+                {
+                    auto vertex = queue[head];
+                    for (auto successor : m_graph.successors(vertex))
+                    {
+                        if (!removed[successor] && (--numIn[successor] == 0))
+                        {
+                            remove(successor);
+                        }
+                    }
+                    for (auto predecessor : m_graph.predecessors(vertex))
+                    {
+                        if (!removed[predecessor] && (--numOut[predecessor] == 0))
+                        {
+                            remove(predecessor);
+                        }
+                    }
+                }
+
+                std::vector< VertexId > remaining;
+                for (VertexId vertex = 0; vertex < numVertices; ++vertex)
+                {
+                    if (!removed[vertex])
+                    {
+                        remaining.push_back(vertex);
+                    }
+                }
+                return remaining;
+            }
+
+            //! The color of a vertex. Relaxed: a vertex of another task never has the color of this one.
+            [[nodiscard]] std::uint32_t colorOf(VertexId vertex)
+            {
+                return std::atomic_ref(m_color[vertex]).load(std::memory_order_relaxed);
+            }
+
+            //! Set the color of a vertex of the task.
+            void setColor(VertexId vertex, std::uint32_t color)
+            {
+                std::atomic_ref(m_color[vertex]).store(color, std::memory_order_relaxed);
+            }
+
+            //! Mark all vertices of the task that are reachable from the pivot, in the given direction.
+            template < typename Neighbours >
+            void search(VertexId pivot, std::uint32_t color, std::uint8_t bit, Neighbours&& neighbours)
+            {
+                std::vector< VertexId > queue{pivot};
+                m_mark[pivot] |= bit;
+                for (std::size_t head = 0; head < queue.size(); ++head)
+                {
+                    for (auto neighbour : neighbours(queue[head]))
+                    {
+                        if ((colorOf(neighbour) == color) && ((m_mark[neighbour] & bit) == 0))
+                        {
+                            m_mark[neighbour] |= bit;
+                            queue.push_back(neighbour);
+                        }
+                    }
+                }
+            }
+
+            //! Add a component to the results, if it is large enough.
+            template < typename Iterator >
+            void emit(Iterator first, Iterator last, SCCs& results) const
+            {
+                if (static_cast< std::size_t >(last - first) >= m_minSize)
+                {
+                    results.emplace_back(first, last);
+                }
+            }
+
+            //! Find all components of a task with Tarjan.
+            void solve(const Task& task, SCCs& results)
+            {
+                for (std::size_t i = 0; i < task.vertices.size(); ++i)
+                {
+                    m_local[task.vertices[i]] = static_cast< std::uint32_t >(i);
+                }
+                tarjan(
+                    m_graph, task.vertices, [&](VertexId vertex) { return colorOf(vertex) == task.color; },
+                    [&](VertexId vertex) { return m_local[vertex]; },
+                    [&](auto first, auto last) { emit(first, last, results); });
+                for (auto vertex : task.vertices)
+                {
+                    setColor(vertex, trimmed);
+                }
+            }
+
+            //! Split a task into its pivot's component and up to three new tasks.
+            void process(Task& task, SCCs& results)
+            {
+                auto color = task.color;
+                if (task.vertices.size() < tarjanThreshold)
+                {
+                    solve(task, results);
+                    return;
+                }
+
+                // Vertices with many in- and outgoing edges are likely part of a large component.
+                auto pivot = std::ranges::max(task.vertices, {},
+                                              [&](VertexId vertex)
+                                              { return m_graph.inDegree(vertex) * m_graph.outDegree(vertex); });
+
+                search(pivot, color, forward, [&](VertexId vertex) { return m_graph.successors(vertex); });
+                search(pivot, color, backward, [&](VertexId vertex) { return m_graph.predecessors(vertex); });
+
+                auto componentSize = static_cast< std::size_t >(
+                    std::ranges::count_if(task.vertices, [&](VertexId vertex)
+                                          { return m_mark[vertex] == (forward | backward); }));
+                if (componentSize * minComponentShare < task.vertices.size())
+                {
+                    for (auto vertex : task.vertices)
+                    {
+                        m_mark[vertex] = 0;
+                    }
+                    solve(task, results);
+                    return;
+                }
+
+                std::vector< VertexId > component;
+                std::vector< VertexId > forwardOnly;
+                std::vector< VertexId > backwardOnly;
+                std::vector< VertexId > neither;
+                for (auto vertex : task.vertices)
+                {
+                    auto mark = std::exchange(m_mark[vertex], 0);
+                    if (mark == (forward | backward))
+                    {
+                        component.push_back(vertex);
+                        setColor(vertex, trimmed);
+                    }
+                    else if (mark == forward)
+                    {
+                        forwardOnly.push_back(vertex);
+                    }
+                    else if (mark == backward)
+                    {
+                        backwardOnly.push_back(vertex);
+                    }
+                    else
+                    {
+                        neither.push_back(vertex);
+                    }
+                }
+                emit(component.begin(), component.end(), results);
+
+                for (auto* vertices : {&forwardOnly, &backwardOnly, &neither})
+                {
+                    if (vertices->empty())
+                    {
+                        continue;
+                    }
+
+                    auto newColor = m_nextColor++;
+                    for (auto vertex : *vertices)
+                    {
+                        setColor(vertex, newColor);
+                    }
+                    ++m_pending;
+                    m_queue.push(Task{.color = newColor, .vertices = std::move(*vertices)});
+                }
+            }
+        };
+    } // namespace detail
+
+    /**
+     * Find the strongly connected components of a graph.
+     *
+     * @param graph The graph
+     * @param options Select the algorithm, the number of threads and the min. size of the components.
+     *
+     * @return The components. With Tarjan, in reverse topological order: a component is listed before all components
+     * that reach it. With forward-backward, sorted by their smallest vertex, each component sorted.
+     */
+    [[nodiscard]] inline SCCs stronglyConnectedComponents(const CSRGraph& graph, const SCCOptions& options = {})
+    {
+        auto algorithm = options.algorithm;
+        if (algorithm == SCCAlgorithm::automatic)
+        {
+            auto isLarge = (graph.numVertices() + graph.numEdges()) >= options.parallelThreshold;
+            algorithm = (isLarge && (options.jobs > 1)) ? SCCAlgorithm::forwardBackward : SCCAlgorithm::tarjan;
+        }
+
+        if (algorithm == SCCAlgorithm::forwardBackward)
+        {
+            return detail::ForwardBackward(graph, options.minSize, options.jobs).run();
+        }
+
+        SCCs result;
+        auto numVertices = static_cast< VertexId >(graph.numVertices());
+        detail::tarjan(
+            graph, std::views::iota(VertexId{0}, numVertices), [](VertexId) { return true; },
+            [](VertexId vertex) { return vertex; },
+            [&](auto first, auto last)
+            {
+                if (static_cast< std::size_t >(last - first) >= options.minSize)
+                {
+                    auto& component = result.emplace_back(first, last);
+                    std::ranges::reverse(component);
+                }
+            });
+        return result;
+    }
+} // namespace mgt
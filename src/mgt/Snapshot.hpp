@@ -0,0 +1,616 @@
+#pragma once
+
+#include "Binary.hpp"
+#include "CSRGraph.hpp"
+#include "MappedFile.hpp"
+#include "SCC.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mgt
+{
+    /**
+     * A module graph stored in a compact binary file: module names, edges, SCCs and metrics. Two snapshots, e.g. of
+     * two builds, can be compared without loading any DDI files. See @ref diff.
+     *
+     * Modules are numbered in the order of their names. This way, the modules, edges and SCCs of two snapshots can be
+     * compared by merging sorted arrays.
+     *
+     * Layout, all integers are 32 bit little-endian: magic, version, number of modules, edges, SCCs and SCC members,
+     * size of the names. Then the arrays: name offsets (modules + 1), fan-in (modules), flags (modules), edge offsets
+     * (modules + 1), edge targets (edges), SCC offsets (SCCs + 1), SCC members (SCC members), and the names, without
+     * separators. The arrays are used in place, right from the mapped file.
+     */
+    class Snapshot
+    {
+    public:
+        //! Flags of a module
+        enum Flags : std::uint32_t
+        {
+            //! No source provides the module
+            missing = 1U << 0U,
+            //! More than one source provides the module
+            multipleProviders = 1U << 1U
+        };
+
+        /**
+         * Write a snapshot of a graph.
+         *
+         * @throw std::runtime_error If the file cannot be written.
+         *
+         * @param file The file to write to
+         * @param names The name of each vertex. Must be unique.
+         * @param graph The graph
+         * @param sccs The SCCs of the graph
+         * @param numIn The number of incoming edges of each vertex. May count more than the graph has.
+         * @param flags The @ref Flags of each vertex
+         */
+        static void save(const std::filesystem::path& file, std::span< const std::string_view > names,
+                         const CSRGraph& graph, const SCCs& sccs, std::span< const std::uint32_t > numIn,
+                         std::span< const std::uint32_t > flags)
+        {
+            auto numModules = names.size();
+            std::vector< VertexId > vertexOf(numModules);
+            std::iota(vertexOf.begin(), vertexOf.end(), VertexId{0});
+            std::ranges::sort(vertexOf, {}, [&](VertexId vertex) { return names[vertex]; });
+            std::vector< std::uint32_t > idOf(numModules);
+            for (std::size_t id = 0; id < numModules; ++id)
+            {
+                idOf[vertexOf[id]] = static_cast< std::uint32_t >(id);
+            }
+
+            // The SCCs in terms of snapshot IDs, each one sorted and all of them too.
+            std::vector< std::vector< std::uint32_t > > components;
+            std::size_t numMembers = 0;
+            for (const auto& scc : sccs)
+            {
+                auto& component = components.emplace_back(
+                    scc | std::views::transform([&](VertexId vertex) { return idOf[vertex]; }) |
+                    std::ranges::to< std::vector >());
+                std::ranges::sort(component);
+                numMembers += component.size();
+            }
+            std::ranges::sort(components);
+
+            std::size_t nameBytes = 0;
+            for (auto name : names)
+            {
+                nameBytes += name.size();
+            }
+
+            BinaryWriter out;
+            out.writeBytes(magic);
+            out.write(formatVersion);
+            out.writeSize(numModules);
+            out.writeSize(graph.numEdges());
+            out.writeSize(components.size());
+            out.writeSize(numMembers);
+            out.writeSize(nameBytes);
+
+            std::uint32_t offset = 0;
+            out.write(offset);
+            for (auto vertex : vertexOf)
+            {
+                offset += static_cast< std::uint32_t >(names[vertex].size());
+                out.write(offset);
+            }
+            for (auto vertex : vertexOf)
+            {
+                out.write(numIn[vertex]);
+            }
+            for (auto vertex : vertexOf)
+            {
+                out.write(flags[vertex]);
+            }
+
+            // The successors of each module, sorted by their new IDs.
+            offset = 0;
+            out.write(offset);
+            for (auto vertex : vertexOf)
+            {
+                offset += static_cast< std::uint32_t >(graph.outDegree(vertex));
+                out.write(offset);
+            }
+            std::vector< std::uint32_t > targets;
+            for (auto vertex : vertexOf)
+            {
+                targets.clear();
+                for (auto successor : graph.successors(vertex))
+                {
+                    targets.push_back(idOf[successor]);
+                }
+                std::ranges::sort(targets);
+                for (auto target : targets)
+                {
+                    out.write(target);
+                }
+            }
+
+            offset = 0;
+            out.write(offset);
+            for (const auto& component : components)
+            {
+                offset += static_cast< std::uint32_t >(component.size());
+                out.write(offset);
+            }
+            for (const auto& component : components)
+            {
+                for (auto member : component)
+                {
+                    out.write(member);
+                }
+            }
+
+            for (auto vertex : vertexOf)
+            {
+                out.writeBytes(names[vertex]);
+            }
+
+            std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+            stream.write(out.buffer().data(), static_cast< std::streamsize >(out.buffer().size()));
+            if (!stream)
+            {
+                throw std::runtime_error(std::format("Cannot write {}", file.string()));
+            }
+        }
+
+        /**
+         * Load a snapshot. The file is mapped, not parsed.
+         *
+         * @throw std::runtime_error If the file cannot be read or is not a valid snapshot.
+         *
+         * @param file The snapshot file
+         *
+         * @return The snapshot
+         */
+        [[nodiscard]] static Snapshot load(const std::filesystem::path& file)
+        {
+            Snapshot result;
+            result.m_file = std::make_unique< MappedFile >(file);
+            try
+            {
+                result.read(result.m_file->view());
+            }
+            catch (std::exception& e)
+            {
+                throw std::runtime_error(std::format("Invalid snapshot {}: {}", file.string(), e.what()));
+            }
+            return result;
+        }
+
+        //! The number of modules
+        [[nodiscard]] std::size_t numModules() const
+        {
+            return m_numIn.size();
+        }
+
+        //! The number of edges
+        [[nodiscard]] std::size_t numEdges() const
+        {
+            return m_targets.size();
+        }
+
+        //! The name of a module
+        [[nodiscard]] std::string_view name(std::uint32_t id) const
+        {
+            return m_names.substr(m_nameOffsets[id], m_nameOffsets[id + 1] - m_nameOffsets[id]);
+        }
+
+        //! The number of modules and compilation units that import a module
+        [[nodiscard]] std::uint32_t numIn(std::uint32_t id) const
+        {
+            return m_numIn[id];
+        }
+
+        //! The number of modules a module imports
+        [[nodiscard]] std::uint32_t numOut(std::uint32_t id) const
+        {
+            return m_edgeOffsets[id + 1] - m_edgeOffsets[id];
+        }
+
+        //! The @ref Flags of a module
+        [[nodiscard]] std::uint32_t flags(std::uint32_t id) const
+        {
+            return m_flags[id];
+        }
+
+        //! The modules a module imports, sorted.
+        [[nodiscard]] std::span< const std::uint32_t > successors(std::uint32_t id) const
+        {
+            return m_targets.subspan(m_edgeOffsets[id], numOut(id));
+        }
+
+        //! The number of SCCs
+        [[nodiscard]] std::size_t numSCCs() const
+        {
+            return m_sccOffsets.size() - 1;
+        }
+
+        //! The modules of an SCC, sorted. The SCCs are sorted as well.
+        [[nodiscard]] std::span< const std::uint32_t > scc(std::size_t index) const
+        {
+            return m_sccMembers.subspan(m_sccOffsets[index], m_sccOffsets[index + 1] - m_sccOffsets[index]);
+        }
+
+    private:
+        //! Identifies the snapshot file format
+        static constexpr std::string_view magic = "MGTSNAP1";
+
+        //! Increment whenever the format changes.
+        static constexpr std::uint32_t formatVersion = 1;
+
+        //! The mapped file
+        std::unique_ptr< MappedFile > m_file;
+
+        //! Copies of arrays that cannot be used in place: on big-endian platforms or if not aligned.
+        std::vector< std::vector< std::uint32_t > > m_copies;
+
+        std::span< const std::uint32_t > m_nameOffsets;
+        std::span< const std::uint32_t > m_numIn;
+        std::span< const std::uint32_t > m_flags;
+        std::span< const std::uint32_t > m_edgeOffsets;
+        std::span< const std::uint32_t > m_targets;
+        std::span< const std::uint32_t > m_sccOffsets;
+        std::span< const std::uint32_t > m_sccMembers;
+        std::string_view m_names;
+
+        Snapshot() = default;
+
+        /**
+         * Set up the arrays and validate them. See the class documentation for the layout.
+         *
+         * @throw std::runtime_error If the data is not a valid snapshot.
+         */
+        void read(std::string_view data)
+        {
+            BinaryReader in(data);
+            if (in.take(magic.size()) != magic)
+            {
+                throw std::runtime_error("Not a snapshot.");
+            }
+            if (auto version = in.read< std::uint32_t >(); version != formatVersion)
+            {
+                throw std::runtime_error(std::format("Unsupported version {}.", version));
+            }
+
+            auto numModules = in.readSize(data.size());
+            auto numEdges = in.readSize(data.size());
+            auto numSCCs = in.readSize(data.size());
+            auto numMembers = in.readSize(data.size());
+            auto nameBytes = in.readSize(data.size());
+
+            m_nameOffsets = array(in, numModules + 1);
+            m_numIn = array(in, numModules);
+            m_flags = array(in, numModules);
+            m_edgeOffsets = array(in, numModules + 1);
+            m_targets = array(in, numEdges);
+            m_sccOffsets = array(in, numSCCs + 1);
+            m_sccMembers = array(in, numMembers);
+            m_names = in.take(nameBytes);
+            if (!in.atEnd())
+            {
+                throw std::runtime_error("Unexpected data at the end.");
+            }
+
+            // The accessors do not check anything. Make sure all offsets and IDs are in range.
+            auto isValidOffsets = [](std::span< const std::uint32_t > offsets, std::size_t size)
+            { return (offsets.front() == 0) && (offsets.back() == size) && std::ranges::is_sorted(offsets); };
+            auto isValidId = [&](std::uint32_t id) { return id < numModules; };
+            if (!isValidOffsets(m_nameOffsets, nameBytes) || !isValidOffsets(m_edgeOffsets, numEdges) ||
+                !isValidOffsets(m_sccOffsets, numMembers) || !std::ranges::all_of(m_targets, isValidId) ||
+                !std::ranges::all_of(m_sccMembers, isValidId))
+            {
+                throw std::runtime_error("Invalid offsets or module IDs.");
+            }
+
+            // Comparing snapshots relies on the order of the names.
+            for (std::uint32_t id = 1; id < numModules; ++id)
+            {
+                if (name(id - 1) >= name(id))
+                {
+                    throw std::runtime_error("Module names are not sorted.");
+                }
+            }
+        }
+
+        /**
+         * Get an array of 32 bit integers. Used in place, if possible.
+         *
+         * @throw std::runtime_error If the data is truncated.
+         */
+        [[nodiscard]] std::span< const std::uint32_t > array(BinaryReader& in, std::size_t size)
+        {
+            auto bytes = in.take(size * sizeof(std::uint32_t));
+            auto isAligned = (reinterpret_cast< std::uintptr_t >(bytes.data()) % alignof(std::uint32_t)) == 0;
+            if ((std::endian::native == std::endian::little) && isAligned)
+            {
+                return {reinterpret_cast< const std::uint32_t* >(bytes.data()), size}; // NOLINT: mapped data.
+            }
+
+            auto& copy = m_copies.emplace_back(size);
+            BinaryReader values(bytes);
+            for (auto& value : copy)
+            {
+                value = values.read< std::uint32_t >();
+            }
+            return copy;
+        }
+    };
+
+    /**
+     * The differences between two snapshots. The names point into the snapshots. They have to outlive the diff.
+     */
+    struct SnapshotDiff
+    {
+        //! A module whose number of incoming or outgoing edges changed
+        struct Degree
+        {
+            std::string_view name;
+            std::uint32_t numInBefore = 0;
+            std::uint32_t numInAfter = 0;
+            std::uint32_t numOutBefore = 0;
+            std::uint32_t numOutAfter = 0;
+        };
+
+        //! Modules that only exist afterwards. Sorted.
+        std::vector< std::string_view > addedModules;
+        //! Modules that only existed before. Sorted.
+        std::vector< std::string_view > removedModules;
+        //! Imports that only exist afterwards. Sorted.
+        std::vector< std::pair< std::string_view, std::string_view > > addedEdges;
+        //! Imports that only existed before. Sorted.
+        std::vector< std::pair< std::string_view, std::string_view > > removedEdges;
+        //! Modules that are missing afterwards, but were not before. Sorted.
+        std::vector< std::string_view > newMissing;
+        //! Modules that were missing before, but are not afterwards. Sorted.
+        std::vector< std::string_view > resolvedMissing;
+        //! Modules with multiple sources afterwards, but not before. Sorted.
+        std::vector< std::string_view > newMultipleProviders;
+        //! SCCs that only exist afterwards. An SCC that grew or shrank counts as a new one.
+        std::vector< std::vector< std::string_view > > addedSCCs;
+        //! SCCs that only existed before
+        std::vector< std::vector< std::string_view > > removedSCCs;
+        //! Modules that exist before and afterwards, but with a different number of edges. Sorted by name.
+        std::vector< Degree > degrees;
+
+        //! True if there are new circular dependencies or missing modules.
+        [[nodiscard]] bool hasNewErrors() const
+        {
+            return !addedSCCs.empty() || !newMissing.empty();
+        }
+    };
+
+    /**
+     * Compare two snapshots. Linear in the size of the snapshots, as all arrays are sorted by name.
+     *
+     * @param before The old snapshot
+     * @param after The new snapshot
+     *
+     * @return The differences
+     */
+    [[nodiscard]] inline SnapshotDiff diff(const Snapshot& before, const Snapshot& after)
+    {
+        SnapshotDiff result;
+        auto flagsChanged = [&](std::uint32_t flagsBefore, std::uint32_t flagsAfter, std::string_view name)
+        {
+            if (((flagsAfter & Snapshot::missing) != 0) && ((flagsBefore & Snapshot::missing) == 0))
+            {
+                result.newMissing.push_back(name);
+            }
+            if (((flagsBefore & Snapshot::missing) != 0) && ((flagsAfter & Snapshot::missing) == 0))
+            {
+                result.resolvedMissing.push_back(name);
+            }
+            if (((flagsAfter & Snapshot::multipleProviders) != 0) &&
+                ((flagsBefore & Snapshot::multipleProviders) == 0))
+            {
+                result.newMultipleProviders.push_back(name);
+            }
+        };
+
+        // Merge the sorted modules and, for modules in both, their sorted successors.
+        std::uint32_t i = 0;
+        std::uint32_t j = 0;
+        while ((i < before.numModules()) || (j < after.numModules()))
+        {
+            auto order = (i == before.numModules())  ? std::strong_ordering::greater
+                         : (j == after.numModules()) ? std::strong_ordering::less
+                                                     : (before.name(i) <=> after.name(j));
+            if (order < 0)
+            {
+                result.removedModules.push_back(before.name(i));
+                for (auto to : before.successors(i))
+                {
+                    result.removedEdges.emplace_back(before.name(i), before.name(to));
+                }
+                flagsChanged(before.flags(i), 0, before.name(i));
+                ++i;
+                continue;
+            }
+            if (order > 0)
+            {
+                result.addedModules.push_back(after.name(j));
+                for (auto to : after.successors(j))
+                {
+                    result.addedEdges.emplace_back(after.name(j), after.name(to));
+                }
+                flagsChanged(0, after.flags(j), after.name(j));
+                ++j;
+                continue;
+            }
+
+            auto name = after.name(j);
+            auto successorsBefore = before.successors(i);
+            auto successorsAfter = after.successors(j);
+            auto k = successorsBefore.begin();
+            auto l = successorsAfter.begin();
+            while ((k != successorsBefore.end()) || (l != successorsAfter.end()))
+            {
+                auto edgeOrder = (k == successorsBefore.end())  ? std::strong_ordering::greater
+                                 : (l == successorsAfter.end()) ? std::strong_ordering::less
+                                                                : (before.name(*k) <=> after.name(*l));
+                if (edgeOrder < 0)
+                {
+                    result.removedEdges.emplace_back(name, before.name(*k++));
+                }
+                else if (edgeOrder > 0)
+                {
+                    result.addedEdges.emplace_back(name, after.name(*l++));
+                }
+                else
+                {
+                    ++k;
+                    ++l;
+                }
+            }
+
+            if ((before.numIn(i) != after.numIn(j)) || (before.numOut(i) != after.numOut(j)))
+            {
+                result.degrees.push_back({.name = name,
+                                          .numInBefore = before.numIn(i),
+                                          .numInAfter = after.numIn(j),
+                                          .numOutBefore = before.numOut(i),
+                                          .numOutAfter = after.numOut(j)});
+            }
+            flagsChanged(before.flags(i), after.flags(j), name);
+            ++i;
+            ++j;
+        }
+
+        // The SCCs are sorted by their sorted members, which are sorted by name. Merge them the same way.
+        auto names = [](const Snapshot& snapshot, std::size_t index)
+        {
+            return snapshot.scc(index) | std::views::transform([&](auto id) { return snapshot.name(id); }) |
+                   std::ranges::to< std::vector >();
+        };
+        std::size_t k = 0;
+        std::size_t l = 0;
+        while ((k < before.numSCCs()) || (l < after.numSCCs()))
+        {
+            auto sccBefore = (k < before.numSCCs()) ? names(before, k) : std::vector< std::string_view >{};
+            auto sccAfter = (l < after.numSCCs()) ? names(after, l) : std::vector< std::string_view >{};
+            auto order = (k == before.numSCCs()) ? std::strong_ordering::greater
+                         : (l == after.numSCCs()) ? std::strong_ordering::less
+                                                  : (sccBefore <=> sccAfter);
+            if (order < 0)
+            {
+                result.removedSCCs.push_back(std::move(sccBefore));
+                ++k;
+            }
+            else if (order > 0)
+            {
+                result.addedSCCs.push_back(std::move(sccAfter));
+                ++l;
+            }
+            else
+            {
+                ++k;
+                ++l;
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * Prints the differences between two snapshots.
+     *
+     * @param diff The differences
+     * @param maxDegrees The max. number of modules with changed edges to list. Largest change of incoming edges first.
+     */
+    inline void printDiff(const SnapshotDiff& diff, std::size_t maxDegrees = 20)
+    {
+        auto join = [](const auto& names)
+        { return names | std::views::join_with(std::string_view(", ")) | std::ranges::to< std::string >(); };
+
+        std::cout << std::format("Modules: {} added, {} removed\n", diff.addedModules.size(),
+                                 diff.removedModules.size());
+        for (auto name : diff.addedModules)
+        {
+            std::cout << std::format("   + {}\n", name);
+        }
+        for (auto name : diff.removedModules)
+        {
+            std::cout << std::format("   - {}\n", name);
+        }
+
+        std::cout << std::format("Imports: {} added, {} removed\n", diff.addedEdges.size(), diff.removedEdges.size());
+        for (const auto& [from, to] : diff.addedEdges)
+        {
+            std::cout << std::format("   + {} -> {}\n", from, to);
+        }
+        for (const auto& [from, to] : diff.removedEdges)
+        {
+            std::cout << std::format("   - {} -> {}\n", from, to);
+        }
+
+        if (!diff.degrees.empty())
+        {
+            auto degrees = diff.degrees;
+            auto delta = [](const SnapshotDiff::Degree& degree)
+            { return static_cast< std::int64_t >(degree.numInAfter) - degree.numInBefore; };
+            std::ranges::stable_sort(degrees, std::ranges::greater{}, delta);
+
+            std::cout << std::format("Modules with changed imports: {}, largest increase of importers first:\n",
+                                     degrees.size());
+            for (const auto& degree : degrees | std::views::take(maxDegrees))
+            {
+                std::cout << std::format("   {}: imported by {} -> {} ({:+}), imports {} -> {}\n", degree.name,
+                                         degree.numInBefore, degree.numInAfter, delta(degree), degree.numOutBefore,
+                                         degree.numOutAfter);
+            }
+            if (degrees.size() > maxDegrees)
+            {
+                std::cout << std::format("   ... and {} more\n", degrees.size() - maxDegrees);
+            }
+        }
+        std::cout << "\n";
+
+        for (auto name : diff.newMultipleProviders)
+        {
+            std::cout << std::format("W: New multiple sources for module \"{}\"\n", name);
+        }
+        for (auto name : diff.newMissing)
+        {
+            std::cout << std::format("E: New missing module: {}\n", name);
+        }
+        for (const auto& scc : diff.addedSCCs)
+        {
+            std::cout << std::format("E: New circular dependency:\n   -> Strongly connected components: {}\n",
+                                     join(scc));
+        }
+        for (auto name : diff.resolvedMissing)
+        {
+            std::cout << std::format("I: No longer missing: {}\n", name);
+        }
+        for (const auto& scc : diff.removedSCCs)
+        {
+            std::cout << std::format("I: Circular dependency gone:\n   -> Strongly connected components: {}\n",
+                                     join(scc));
+        }
+
+        auto numWarnings = diff.newMultipleProviders.size();
+        auto numErrors = diff.newMissing.size() + diff.addedSCCs.size();
+        auto numResolved = diff.resolvedMissing.size() + diff.removedSCCs.size();
+        std::cout << std::format("{}New warnings: {}, new errors: {}\n",
+                                 (numWarnings + numErrors + numResolved > 0) ? "\n" : "", numWarnings, numErrors);
+    }
+} // namespace mgt
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "CSRGraph.hpp"
+#include "Condensation.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <vector>
+
+namespace mgt
+{
+    //! An edge that is implied by other edges: "to" is reachable from "through", which "from" has an edge to as well.
+    struct RedundantEdge
+    {
+        //! The start of the edge
+        VertexId from = 0;
+        //! The end of the edge
+        VertexId to = 0;
+        //! A successor of "from" that "to" is reachable from
+        VertexId through = 0;
+
+        bool operator==(const RedundantEdge&) const = default;
+    };
+
+    //! Options for @ref findRedundantEdges.
+    struct TransitiveReductionOptions
+    {
+        //! The number of threads to use
+        unsigned jobs = 1;
+
+        //! The max. number of bytes of reachability bits per thread. Larger graphs are processed in several passes.
+        std::size_t maxBytes = std::size_t{256} << 20U;
+    };
+
+    /**
+     * Find the edges that are not part of the transitive reduction of a graph: an edge u -> v is redundant, if v is
+     * reachable from another successor w of u. For the module graph, this is an import that is already imported
+     * indirectly.
+     *
+     * The graph is condensed first. Edges within an SCC and edges to successors within the same SCC as u are ignored,
+     * as cycles are reported on their own. For each component, the set of components reachable from it is kept as a
+     * bitset, filled in build order (see @ref Condensation::order): the set of a component is the union of the sets of
+     * its successors plus the successors themselves. An edge u -> v is then redundant, if v is in the set of any other
+     * successor of u.
+     *
+     * The bitsets take O(C^2) bits for C components. If they do not fit in the given memory, the columns (the
+     * reachable components) are split into chunks. Each chunk is an independent pass over the graph, hence they are
+     * processed in parallel. Each pass takes O((V + E) * C / 64) word operations.
+     *
+     * @param graph The graph
+     * @param condensation The condensation of the graph
+     * @param options The number of threads and the memory to use
+     *
+     * @return The redundant edges, sorted by from and to.
+     */
+    [[nodiscard]] inline std::vector< RedundantEdge > findRedundantEdges(const CSRGraph& graph,
+                                                                       const Condensation& condensation,
+                                                                       const TransitiveReductionOptions& options = {})
+    {
+        constexpr std::size_t bitsPerWord = 64;
+        const auto& dag = condensation.dag;
+        const auto& componentOf = condensation.componentOf;
+        auto numComponents = dag.numVertices();
+        if (numComponents == 0)
+        {
+            return {};
+        }
+
+        // The columns per chunk: a multiple of the word size, so that the memory limit holds for all rows.
+        auto numJobs = std::max(1U, options.jobs);
+        auto bytesPerRowWord = numComponents * sizeof(std::uint64_t);
+        auto wordsPerChunk = std::max< std::size_t >(1, options.maxBytes / numJobs / bytesPerRowWord);
+        auto columnsPerChunk = std::min(wordsPerChunk * bitsPerWord,
+                                        (numComponents + bitsPerWord - 1) / bitsPerWord * bitsPerWord);
+        auto numChunks = (numComponents + columnsPerChunk - 1) / columnsPerChunk;
+
+        std::vector< std::vector< RedundantEdge > > found(numChunks);
+        parallelFor(numChunks, numJobs,
+                    [&](std::size_t chunk, unsigned /*worker*/)
+                    {
+                        auto first = chunk * columnsPerChunk;
+                        auto last = std::min(first + columnsPerChunk, numComponents);
+                        auto numWords = (last - first + bitsPerWord - 1) / bitsPerWord;
+
+                        auto contains = [&](std::size_t column) { return (column >= first) && (column < last); };
+                        auto bit = [&](std::size_t column)
+                        { return std::uint64_t{1} << ((column - first) % bitsPerWord); };
+                        auto word = [&](std::size_t column) { return (column - first) / bitsPerWord; };
+
+                        // The components reachable from each component, restricted to the columns of this chunk.
+                        std::vector< std::uint64_t > reachable(numComponents * numWords, 0);
+                        auto row = [&](std::size_t component) { return reachable.data() + (component * numWords); };
+                        for (auto component : condensation.order)
+                        {
+                            auto* target = row(component);
+                            for (auto successor : dag.successors(component))
+                            {
+                                const auto* source = row(successor);
+                                for (std::size_t i = 0; i < numWords; ++i)
+                                {
+                                    target[i] |= source[i]; // NOLINT: pointer arithmetic.
+                                }
+                                if (contains(successor))
+                                {
+                                    target[word(successor)] |= bit(successor); // NOLINT: pointer arithmetic.
+                                }
+                            }
+                        }
+
+                        // Only the edges ending in this chunk are checked.
+                        std::vector< std::uint64_t > indirect(numWords);
+                        for (VertexId from = 0; from < graph.numVertices(); ++from)
+                        {
+                            auto component = componentOf[from];
+                            auto isCandidate = [&](VertexId to)
+                            { return (componentOf[to] != component) && contains(componentOf[to]); };
+                            if (std::ranges::none_of(graph.successors(from), isCandidate))
+                            {
+                                continue;
+                            }
+
+                            std::ranges::fill(indirect, 0);
+                            for (auto successor : graph.successors(from))
+                            {
+                                if (componentOf[successor] == component)
+                                {
+                                    continue;
+                                }
+                                const auto* source = row(componentOf[successor]);
+                                for (std::size_t i = 0; i < numWords; ++i)
+                                {
+                                    indirect[i] |= source[i]; // NOLINT: pointer arithmetic.
+                                }
+                            }
+
+                            for (auto to : graph.successors(from) | std::views::filter(isCandidate))
+                            {
+                                auto column = componentOf[to];
+                                if ((indirect[word(column)] & bit(column)) == 0)
+                                {
+                                    continue;
+                                }
+
+                                // Any successor that reaches "to" will do, take the first one.
+                                for (auto through : graph.successors(from))
+                                {
+                                    if ((componentOf[through] != component) &&
+                                        ((row(componentOf[through])[word(column)] & bit(column)) != 0))
+                                    {
+                                        found[chunk].push_back({.from = from, .to = to, .through = through});
+                                        break;
+                                    }
+                                }
+                            }
+                        }
+                    });
+
+        std::vector< RedundantEdge > result;
+        for (auto& edges : found)
+        {
+            result.insert(result.end(), edges.begin(), edges.end());
+        }
+        std::ranges::sort(result, [](const auto& lhs, const auto& rhs)
+                          { return (lhs.from != rhs.from) ? (lhs.from < rhs.from) : (lhs.to < rhs.to); });
+        return result;
+    }
+} // namespace mgt
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+#ifdef __linux__
+    #include <algorithm>
+    #include <array>
+    #include <cerrno>
+    #include <cstddef>
+    #include <cstdint>
+    #include <cstring>
+    #include <format>
+    #include <string>
+    #include <system_error>
+    #include <unordered_map>
+
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace mgt
+{
+    //! A set of changed DDI files, as reported by @ref DirectoryWatcher.
+    struct DirectoryChanges
+    {
+        //! The added, modified or removed DDI files. Sorted, no duplicates.
+        std::vector< std::filesystem::path > files;
+
+        //! If true, events were lost. The whole directory has to be re-loaded.
+        bool overflow = false;
+    };
+
+#ifdef __linux__
+    /**
+     * Watches a directory tree for added, modified and removed DDI files using inotify. New sub-directories are
+     * watched automatically.
+     */
+    class DirectoryWatcher
+    {
+    public:
+        /**
+         * Start watching the given directory and all its sub-directories.
+         *
+         * @throw std::runtime_error If inotify cannot be set up.
+         *
+         * @param root The directory to watch.
+         */
+        explicit DirectoryWatcher(const std::filesystem::path& root) : m_fd(::inotify_init1(IN_CLOEXEC))
+        {
+            if (m_fd < 0)
+            {
+                throw std::runtime_error(std::format("Cannot initialize inotify: {}", std::strerror(errno)));
+            }
+
+            addTree(root, nullptr);
+        }
+
+        DirectoryWatcher(const DirectoryWatcher&) = delete;
+        DirectoryWatcher(DirectoryWatcher&&) = delete;
+        DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+        DirectoryWatcher& operator=(DirectoryWatcher&&) = delete;
+
+        ~DirectoryWatcher()
+        {
+            ::close(m_fd);
+        }
+
+        /**
+         * Wait for changes. Blocks until at least one DDI file changed. Afterwards, it waits until no more events
+         * arrive for the given settle time. Build systems usually write many DDI files in a row. This collects them
+         * into one batch.
+         *
+         * @throw std::runtime_error If reading the events fails.
+         *
+         * @param settle The time without events after which a batch is considered complete.
+         *
+         * @return The changes
+         */
+        [[nodiscard]] DirectoryChanges wait(std::chrono::milliseconds settle)
+        {
+            DirectoryChanges changes;
+
+            // Block until something relevant happened, then drain until things settle.
+            while (changes.files.empty() && !changes.overflow)
+            {
+                if (poll(-1))
+                {
+                    read(changes);
+                }
+            }
+            while (poll(static_cast< int >(settle.count())))
+            {
+                read(changes);
+            }
+
+            std::ranges::sort(changes.files);
+            auto [first, last] = std::ranges::unique(changes.files);
+            changes.files.erase(first, last);
+            return changes;
+        }
+
+    private:
+        //! The inotify instance
+        int m_fd;
+
+        //! The watched directory per watch descriptor
+        std::unordered_map< int, std::filesystem::path > m_directories;
+
+        //! The events that are of interest for directories
+        static constexpr std::uint32_t eventMask =
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_ONLYDIR;
+
+        //! True if the path is a DDI file
+        [[nodiscard]] static bool isDDI(const std::filesystem::path& path)
+        {
+            return path.extension() == ".ddi";
+        }
+
+        /**
+         * Watch a directory and all its sub-directories.
+         *
+         * @param root The directory
+         * @param changes If set, DDI files found in the tree are added as changes. Used for directories that got
+         * created after watching started. Their files might have been written before the watch was set up.
+         */
+        void addTree(const std::filesystem::path& root, DirectoryChanges* changes)
+        {
+            addDirectory(root);
+
+            std::error_code error;
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(root, error))
+            {
+                if (entry.is_directory())
+                {
+                    addDirectory(entry.path());
+                }
+                else if ((changes != nullptr) && isDDI(entry.path()))
+                {
+                    changes->files.push_back(entry.path());
+                }
+            }
+        }
+
+        //! Watch a single directory
+        void addDirectory(const std::filesystem::path& directory)
+        {
+            // IN_ONLYDIR is part of the mask. Adding a watch for a directory that was removed in the meantime just
+            // fails. Nothing to do in that case.
+            auto wd = ::inotify_add_watch(m_fd, directory.c_str(), eventMask);
+            if (wd >= 0)
+            {
+                m_directories.insert_or_assign(wd, directory);
+            }
+        }
+
+        /**
+         * Wait for events.
+         *
+         * @param timeout In milliseconds. -1 to wait forever.
+         *
+         * @return True if events are available.
+         */
+        [[nodiscard]] bool poll(int timeout) const
+        {
+            pollfd pfd{.fd = m_fd, .events = POLLIN, .revents = 0};
+            while (true)
+            {
+                auto result = ::poll(&pfd, 1, timeout);
+                if ((result < 0) && (errno == EINTR))
+                {
+                    continue;
+                }
+                if (result < 0)
+                {
+                    throw std::runtime_error(
+                        std::format("Failed to wait for inotify events: {}", std::strerror(errno)));
+                }
+                return result > 0;
+            }
+        }
+
+        //! Read all available events and add them to the changes.
+        void read(DirectoryChanges& changes)
+        {
+            alignas(inotify_event) std::array< char, 64 * 1024 > buffer{};
+            auto length = ::read(m_fd, buffer.data(), buffer.size());
+            if (length < 0)
+            {
+                if ((errno == EINTR) || (errno == EAGAIN))
+                {
+                    return;
+                }
+                throw std::runtime_error(std::format("Failed to read inotify events: {}", std::strerror(errno)));
+            }
+
+            for (std::size_t offset = 0; offset < static_cast< std::size_t >(length);)
+            {
+                inotify_event event{};
+                std::memcpy(&event, buffer.data() + offset, sizeof(inotify_event)); // NOLINT: pointer arithmetic.
+                std::string name(buffer.data() + offset + sizeof(inotify_event)); // NOLINT: pointer arithmetic.
+                offset += sizeof(inotify_event) + event.len;
+
+                if ((event.mask & IN_Q_OVERFLOW) != 0)
+                {
+                    changes.overflow = true;
+                    continue;
+                }
+
+                if ((event.mask & IN_IGNORED) != 0)
+                {
+                    // The directory is gone.
+                    m_directories.erase(event.wd);
+                    continue;
+                }
+
+                auto directory = m_directories.find(event.wd);
+                if ((directory == m_directories.end()) || name.empty())
+                {
+                    continue;
+                }
+
+                auto path = directory->second / name;
+                if ((event.mask & IN_ISDIR) != 0)
+                {
+                    if ((event.mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+                    {
+                        addTree(path, &changes);
+                    }
+                    else if ((event.mask & IN_MOVED_FROM) != 0)
+                    {
+                        // A whole tree of DDI files vanished. Simpler to re-load everything.
+                        changes.overflow = true;
+                    }
+                    continue;
+                }
+
+                // IN_CREATE is only of interest for directories. The file content is complete on IN_CLOSE_WRITE.
+                if (isDDI(path) && ((event.mask & IN_CREATE) == 0))
+                {
+                    changes.files.push_back(std::move(path));
+                }
+            }
+        }
+    };
+#else
+    //! Watching directories is only implemented for Linux (inotify). This stub fails on construction.
+    class DirectoryWatcher
+    {
+    public:
+        explicit DirectoryWatcher([[maybe_unused]] const std::filesystem::path& root)
+        {
+            throw std::runtime_error("Watching directories is only supported on Linux.");
+        }
+
+        [[nodiscard]] DirectoryChanges wait([[maybe_unused]] std::chrono::milliseconds settle)
+        {
+            return {};
+        }
+    };
+#endif
+} // namespace mgt